@@ -0,0 +1,227 @@
+// analysis.cpp
+
+#include "analysis.h"
+#include <fstream>
+#include <thread>
+#include <chrono>
+
+using std::string;
+using std::vector;
+using std::format;
+
+namespace Bbot2 {
+
+// AnalysisEngine //
+
+// constructor
+AnalysisEngine::AnalysisEngine()
+	: game(&board), comp(&game) {}
+
+// initialize board, game, and engine
+// sharedTT: table shared with other engines, or nullptr/empty for a TT of the engine's own
+void AnalysisEngine::init(CSimpleIniA* config, vector<TT>* sharedTT) {
+	board.init();
+	game.init();
+
+	comp.settings(config);
+
+	if (sharedTT != nullptr && !sharedTT->empty())
+		comp.share_tt(sharedTT->data(), (u_long) sharedTT->size());
+
+	comp.init();
+}
+
+// search position of job
+// returns result as a JSON object, see analysis.h
+string AnalysisEngine::analyse(AnalysisJob& job, size_t id, int maxTime, int maxDepth, bool withStats, int multiPV) {
+
+	// set up position. engine releases the previous one first, as its game history is keyed by it
+	comp.release_game();
+	game.close();
+
+	board.from_compact(job.position);
+
+	game.init();
+	comp.attach_game(&game);
+
+	comp.multiPV = multiPV;
+
+	// full search
+	auto start = std::chrono::steady_clock::now();
+
+	while (comp.search(maxTime, maxDepth));
+
+	auto time = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+
+	// strings written contain no characters needing escapes
+	string result = format("\"id\": {}, \"side\": \"{}\", \"eval\": \"{}\", \"depth\": {}, \"pv\": \"{}\", \"nodes\": {}, \"time\": {}",
+		id, board.sideToMove ? 'b' : 'w', comp.search_eval(), comp.search_depth(), comp.search_PV(), comp.search_nodes(), time);
+
+	if (multiPV > 1) {
+		result += ", \"lines\": [";
+
+		for (int i = 0; i < comp.search_num_lines(); i ++)
+			result += string(i > 0 ? ", " : "") + "{" + format("\"eval\": \"{}\", \"pv\": \"{}\"", comp.search_eval(i), comp.search_PV(i)) + "}";
+
+		result += "]";
+	}
+
+	if (withStats)
+		result += ", \"stats\": " + comp.search_stats().to_json();
+
+	return "{" + result + "}";
+}
+
+// close engine, game, and board
+void AnalysisEngine::close() {
+	comp.close();
+	game.close();
+	board.close();
+}
+
+////////////////////////////////
+
+// Analysis //
+
+// get settings from .ini
+// engines are configured by the same .ini, so it must outlive run()
+void Analysis::settings(CSimpleIniA* config_) {
+	config = config_;
+
+	maxTime = (int) config->GetLongValue("COMPUTER_PLAYER", "time-limit", maxTime);
+	maxDepth = (int) config->GetLongValue("COMPUTER_PLAYER", "depth-limit", maxDepth);
+	multiPV = (int) config->GetLongValue("COMPUTER_PLAYER", "multipv", multiPV);
+	TT_ALLOC = (u_long) config->GetLongValue("COMPUTER_PLAYER", "transposition-table-allocation", TT_ALLOC);
+}
+
+// read positions file
+void Analysis::load(string filename) {
+	std::ifstream file(filename);
+
+	if (!file)
+		throw Exception("Could not load " + filename);
+
+	string line, squares;
+	int lineNum = 0;
+
+	while (std::getline(file, line)) {
+		lineNum ++;
+
+		if (line.empty() || line[0] == '#')
+			continue;
+
+		if (!parse_positions(line, &squares, &jobs))
+			throw Exception(format("Invalid position at line {} of {}", lineNum, filename));
+	}
+
+	if (!squares.empty())
+		throw Exception("Incomplete position at end of " + filename);
+
+	if (jobs.empty())
+		throw Exception("No positions found in " + filename);
+}
+
+// add positions found in text to jobs_
+// text is either one position in compact notation, or part of boards in Board::from_string format
+// squares holds an incomplete board between calls, so a board may span several calls
+// returns false if text is not a valid compact position, or a complete board is followed by anything but whitespace and w/b
+bool Analysis::parse_positions(const string& text, string* squares, vector<AnalysisJob>* jobs_) {
+	int herds[NUM_SQUARES];
+	Side side;
+	int ply;
+	char buffer[Board::COMPACT_MAX_LEN];
+
+	// compact notation
+	if (squares->empty() && text.find('/') != string::npos) {
+		std::string_view s(text);
+		size_t begin = s.find_first_not_of(" \t\r\n");
+		size_t end = s.find_last_not_of(" \t\r\n");
+
+		if (begin == string::npos || !Board::parse_compact(s.substr(begin, end - begin + 1), herds, &side, &ply))
+			return false;
+
+		// normalized
+		jobs_->push_back({ string(buffer, Board::write_compact(herds, side, ply, buffer)) });
+
+		return true;
+	}
+
+	for (char c : text) {
+
+		// board chars until board is complete
+		if (squares->length() < NUM_SQUARES) {
+			if (string(BOARD_CHARS).find(c) != string::npos)
+				*squares += c;
+
+			continue;
+		}
+
+		// then side to move
+		if (c == 'w' || c == 'b') {
+			for (int i = 0; i < NUM_SQUARES; i ++) {
+				int herd = Board::herd_of((*squares)[i]);
+				herds[(BOARD_SIZE - 1 - i / BOARD_SIZE) * BOARD_SIZE + i % BOARD_SIZE] = herd < NUM_HERDS ? herd : -1;
+			}
+
+			size_t len = Board::write_compact(herds, c == 'w' ? WHITE : BLACK, 0, buffer);
+
+			// checks both sides have pieces
+			if (!Board::parse_compact(std::string_view(buffer, len), herds, &side, &ply))
+				return false;
+
+			jobs_->push_back({ string(buffer, len) });
+			squares->clear();
+		} else if (!std::isspace((unsigned char) c)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+////
+
+// analyse all positions, writing results to out_
+// shareTT: engines share one TT of size TT_ALLOC, instead of allocating one each
+void Analysis::run(std::ostream* out_, int numThreads, bool shareTT) {
+	out = out_;
+
+	if (shareTT)
+		sharedTT.assign(Bbot::tt_size(TT_ALLOC), TT());
+
+	vector<std::thread> threads;
+	for (int i = 0; i < numThreads; i ++)
+		threads.push_back(std::thread(&Analysis::worker, this));
+
+	for (std::thread& t : threads)
+		t.join();
+
+	sharedTT.clear();
+	sharedTT.shrink_to_fit();
+}
+
+////
+
+// analyse positions until none remain
+void Analysis::worker() {
+	try {
+
+	AnalysisEngine engine;
+	engine.init(config, &sharedTT);
+
+	size_t i;
+	while ((i = nextJob ++) < jobs.size()) {
+		string result = engine.analyse(jobs[i], i, maxTime, maxDepth, withStats, multiPV) + "\n";
+
+		std::lock_guard<std::mutex> guard(lock);
+		*out << result << std::flush;
+	}
+
+	engine.close();
+
+	} catch (Exception e) {
+		e.print();
+	}
+}
+
+} // end namespace Bbot2
@@ -0,0 +1,94 @@
+// analysis.h
+
+// batch analysis of a file of positions, searched concurrently on several threads
+// every worker thread owns an AnalysisEngine, and takes the next position until none remain
+// engines may share one transposition table, so positions with common continuations reuse each other's searches
+
+// positions file: positions in compact notation (see Board), one per line, e.g.
+//   4ee4/3lmml3/10/10/10/10/10/10/3LMML3/4EE4 w 0
+// or a board in Board::from_string format followed by 'w' or 'b' for the side to move, over one or several lines
+//   . . . . e e . . . . . . . l m m l . . . ... . . . . E E . . . . w
+// lines starting with '#' are comments
+
+// results are written as they complete, one JSON object per line, e.g.
+//   {"id": 0, "side": "w", "eval": "+0.250", "depth": 8, "pv": "1. Ld2c3 Me9e7", "nodes": 120394, "time": 512}
+// id is the index of the position in the file, time is in ms
+// with stats, results also hold "stats": SearchStats::to_json of the search, one object per iteration of iterative deepening
+// with multipv above 1, results also hold the best lines found, best first, e.g.
+//   "lines": [{"eval": "+0.250", "pv": "1. Ld2c3 Me9e7"}, {"eval": "+0.100", "pv": "1. Me2e4 Me9e7"}]
+
+#pragma once
+
+#include "common.h"
+#include "log.h"
+#include "board.h"
+#include "game.h"
+#include "bbot.h"
+#include <atomic>
+#include <mutex>
+
+namespace Bbot2 {
+
+// position to be analysed
+typedef struct AnalysisJob {
+	std::string position; // compact notation
+} AnalysisJob;
+
+// engine with its own board and game, kept between analyses so its TT stays warm
+// used by Analysis and Server
+class AnalysisEngine {
+	Board board;
+	Game game;
+	Bbot comp;
+
+public:
+	AnalysisEngine();
+
+	void init(CSimpleIniA* config, std::vector<TT>* sharedTT);
+	std::string analyse(AnalysisJob& job, size_t id, int maxTime, int maxDepth, bool withStats = false, int multiPV = 1);
+	void close();
+};
+
+class Analysis {
+public:
+	////
+
+	//// SETTINGS ////
+
+	int maxTime = 1000; // ms per position
+	int maxDepth = MAX_LINE_LEN;
+	int multiPV = 1; // lines per position
+
+	u_long TT_ALLOC = 1 << 20; // size of shared TT, if used
+
+	// usually overrided by .ini in settings()
+
+	bool withStats = false; // include search stats in results
+
+	////
+
+private:
+	CSimpleIniA* config = nullptr; // engine settings
+
+	std::vector<AnalysisJob> jobs;
+	std::atomic<size_t> nextJob = 0;
+
+	std::vector<TT> sharedTT; // empty if every engine has its own TT
+
+	// output, guarded by lock
+	std::mutex lock;
+	std::ostream* out = nullptr;
+
+public:
+	void settings(CSimpleIniA* config_);
+
+	void load(std::string filename);
+	void run(std::ostream* out_, int numThreads, bool shareTT);
+
+	static bool parse_positions(const std::string& text, std::string* squares, std::vector<AnalysisJob>* jobs_);
+
+private:
+	void worker();
+};
+
+} // end namespace Bbot2
@@ -1,6 +1,7 @@
 // bbot.cpp
 
 #include "bbot.h"
+#include <cmath>
 
 using std::string;
 using std::vector;
@@ -22,17 +23,75 @@ Bbot::Bbot(Game* game_)
 
 ////
 
+// get settings from .ini
+void Bbot::settings(CSimpleIniA* config) {
+	TT_ALLOC = (u_long) config->GetLongValue("COMPUTER_PLAYER", "transposition-table-allocation", TT_ALLOC);
+	EVAL_CACHE_ALLOC = (u_long) config->GetLongValue("COMPUTER_PLAYER", "eval-cache-allocation", EVAL_CACHE_ALLOC);
+	bookFile = string(config->GetValue("COMPUTER_PLAYER", "opening-book", ""));
+	networkFile = string(config->GetValue("EVALUATION", "network", ""));
+
+	// tuned evaluation parameters, if present
+	for (EvalParam& param : eval_params())
+		*param.value = (int) config->GetLongValue("EVALUATION", param.ini_key().c_str(), *param.value);
+
+	// cached evals may be of other parameters
+	clear_eval_cache();
+}
+
+// use an external transposition table instead of allocating one
+// call before init. size must be 2^n, see tt_size, and table must outlive engine
+// engines sharing a table should all evaluate with the same network, or none, as positions are keyed differently (see tt_key)
+// engines sharing a table may search on different threads. entries are then read and written without locks,
+// a word at a time, and an entry torn by a concurrent write fails its check in tt_read and is treated as a miss
+void Bbot::share_tt(TT* table, u_long size) {
+	transpositionTable = table;
+	TT_ALLOC = size;
+	ttShared = true;
+}
+
+// round TT size up to nearest 2^n
+u_long Bbot::tt_size(u_long alloc) {
+	u_long n = 1;
+	while (n < alloc) n <<= 1;
+
+	return n;
+}
+
 // init
 void Bbot::init() {
 	if (!game->initialized)
 		game->init();
 
-	// allocate TT
-	transpositionTable = new TT[TT_ALLOC];
+	// allocate TT, unless shared
+	if (!ttShared) {
+		TT_ALLOC = tt_size(TT_ALLOC);
+		transpositionTable = new TT[TT_ALLOC];
+	}
+
+	ttMask = TT_ALLOC - 1;
+
+	// allocate eval cache, always owned by engine
+	EVAL_CACHE_ALLOC = tt_size(EVAL_CACHE_ALLOC);
+	evalCache = new unsigned __int64[EVAL_CACHE_ALLOC]();
+	evalMask = EVAL_CACHE_ALLOC - 1;
 
 	// initialize eval boards
 	init_eval_boards();
 
+	// map opening book
+	if (useBook && !bookFile.empty() && !book.open(bookFile))
+		throw Exception("Could not open opening book " + bookFile);
+
+	// load network
+	if (!networkFile.empty()) {
+		network = std::make_shared<Nnue>();
+		network->load(networkFile);
+		__LOG("Network {} loaded ({})", networkFile, Nnue::simd_name());
+	}
+
+	// cached evals are of the network if loaded, otherwise of the parameters
+	clear_eval_cache();
+
 	// remember starting position
 	gh_store();
 
@@ -66,22 +125,28 @@ bool Bbot::search(int maxTime, int maxDepth) {
 
 	// if not searching, reset values and start search
 	if (!searching) {
-		startClock = std::clock();
-		allottedTime = CLOCKS_PER_SEC * maxTime / 1000; // ms to clocks
+
+		// play book move without searching, if position is in book
+		if (book.is_open() && search_book())
+			return false;
+
+		startClock = std::chrono::steady_clock::now();
+		std::atomic_ref<long long>(allottedTime).store(maxTime, std::memory_order_relaxed);
+
+		// board may be shared with an engine using another network, or none
+		if (board->network != network.get())
+			board->attach_network(network.get());
 
 		searchDepth = 0;
 		eval = 0;
 
-		// log values
 		nodesVisited = 0;
-		ttHits = 0;
-		ttWrites = 0;
-		ttUpdates = 0;
-		ttOverwrites = 0;
+		stats.depths.clear();
+		lines.clear();
 
 		searching = true;
 
-		__LOG(format("[{}]: SEARCHING...", SIDE_NAMES[board->sideToMove]));
+		__LOG("[{}]: SEARCHING...", SIDE_NAMES[board->sideToMove]);
 	}
 
 	// check for search exit
@@ -92,25 +157,35 @@ bool Bbot::search(int maxTime, int maxDepth) {
 		return false;
 
 	// search to depth of next iterative deepening
+	stats.depths.push_back(DepthStats());
+	iteration = &stats.depths.back();
+	iteration->depth = searchDepth + 1;
+
+	auto iterationStart = std::chrono::steady_clock::now();
+
 	search_fixed_depth(searchDepth + 1);
 
+	iteration->time = std::chrono::duration<double>(std::chrono::steady_clock::now() - iterationStart).count();
+
 	// update moves after search tree traversal
 	board->update_move_sets();
 
 	// check time
-	if (search_exit(search_clock() > allottedTime && searchDepth > 0, "TIME EXCEEDED"))
+	if (search_exit(search_clock() > std::atomic_ref<long long>(allottedTime).load(std::memory_order_relaxed) && searchDepth > 0, "TIME EXCEEDED"))
 		return false;
 
 	// log
-	__LOG(format("   DEPTH {} (EVAL {}): {} ({} ms)", searchDepth, search_eval(), search_PV(), searchDuration * 1000));
+	__LOG("   DEPTH {} (EVAL {}): {} ({} ms)", searchDepth, search_eval(), search_PV(), searchDuration * 1000);
+	__LOG("      {}", stats.to_string(stats.depths.size() - 1));
 
 	return true;
 }
 
 // abort search on next loop
 // will log as "TIME EXCEEDED"
+// may be called from another thread than the search
 void Bbot::search_abort() {
-	allottedTime = 0;
+	std::atomic_ref<long long>(allottedTime).store(0, std::memory_order_relaxed);
 }
 
 ////
@@ -137,20 +212,7 @@ void Bbot::on_move_played(Move move) {
 
 // get eval string
 string Bbot::search_eval() {
-
-	// white to mate
-	if (eval >= EVAL_WIN - MAX_LINE_LEN) {
-		return format("+M{}", (EVAL_WIN - eval + 1) / NUM_SIDES);
-	}
-
-	// black to mate
-	if (eval <= -EVAL_WIN + MAX_LINE_LEN)
-		return format("-M{}", (EVAL_WIN + eval + 1) / NUM_SIDES);
-
-	// non-mate eval
-	// 1.0 = +1 watering hole advantage
-
-	return format("{:+.3f}", (float) eval / ON_WH_SCORE[0]);
+	return eval_to_string(eval);
 }
 
 // get PV string
@@ -158,6 +220,21 @@ string Bbot::search_PV() {
 	return board->line_to_string(PV);
 }
 
+// get number of lines found by a MultiPV search, 1 if multiPV is 1
+int Bbot::search_num_lines() {
+	return (int) lines.size();
+}
+
+// get eval of line i of a MultiPV search, line 0 is the PV
+string Bbot::search_eval(int i) {
+	return eval_to_string(lines[i].eval);
+}
+
+// get line i of a MultiPV search
+string Bbot::search_PV(int i) {
+	return board->line_to_string(lines[i].line);
+}
+
 // get if search is ongoing
 bool Bbot::search_ongoing() {
 	return searching;
@@ -168,6 +245,20 @@ int Bbot::search_depth() {
 	return searchDepth;
 }
 
+// get final evaluation of most recent search, positive if favouring white
+int Bbot::search_value() {
+	return eval;
+}
+
+// get final evaluation as a number, in watering holes as in search_eval(), positive if favouring white
+// mates are +/- infinity
+float Bbot::search_score() {
+	if (is_mate_eval(eval))
+		return eval > 0 ? INFINITY : -INFINITY;
+
+	return (float) eval / ON_WH_SCORE[0];
+}
+
 // get time taken by most recent successful search
 double Bbot::search_duration() {
 	return searchDuration;
@@ -176,12 +267,22 @@ double Bbot::search_duration() {
 // get nodes/sec
 int Bbot::search_speed() {
 	if (searchDuration > 0) {
-		return (int) ((double) nodesVisited / search_clock() * CLOCKS_PER_SEC);
+		return (int) ((double) nodesVisited / searchDuration);
 	} else {
 		return 0;
 	}
 }
 
+// get nodes searched by most recent search
+unsigned __int64 Bbot::search_nodes() {
+	return nodesVisited;
+}
+
+// get statistics of most recent search, by iteration
+const SearchStats& Bbot::search_stats() {
+	return stats;
+}
+
 // get move suggested by engine
 // only call after successful search
 Move Bbot::suggested_move() {
@@ -197,7 +298,7 @@ void Bbot::soft_close() {
 }
 
 // close
-// clear game history and de-allocate transposition table
+// clear game history and de-allocate transposition table, unless shared, and eval cache
 void Bbot::close() {
 	if (!initialized)
 		return;
@@ -205,7 +306,18 @@ void Bbot::close() {
 	soft_close();
 
 	// de-allocate TT
-	delete[] transpositionTable;
+	if (!ttShared)
+		delete[] transpositionTable;
+
+	delete[] evalCache;
+	evalCache = nullptr;
+
+	// unmap opening book
+	book.close();
+
+	// board may outlive network
+	if (network && board->network == network.get())
+		board->attach_network(nullptr);
 }
 
 ////////////////////////////////
@@ -216,125 +328,169 @@ void Bbot::close() {
 // value: position eval
 // move: best move - relevant if flag is FLAG_EXACT or FLAG_BETA
 void Bbot::tt_store(u_short depth, Flag_TT flag, int value, Move move) {
+	ProfileScope scope(PROFILE_TT_STORE);
 
 	// previous entry in transposition table
-	TT* entry = tt_current();
+	TT_Entry entry;
+	bool found = tt_read(&entry);
 
 	// do not overwrite if previous entry is exact and new entry is not
-	if (entry->flag == FLAG_EXACT && flag != FLAG_EXACT)
+	if (entry.flag == FLAG_EXACT && flag != FLAG_EXACT)
 		return;
 
 	// do not overwrite if previous entry has a higher priority (determined by depth and recency)
-	if (entry->flag != FLAG_EMPTY && entry->depth + entry->foundAt > depth + game->ply)
+	if (entry.flag != FLAG_EMPTY && entry.depth + entry.foundAt > depth + game->ply)
 		return;
 
-	// log values
-	if constexpr (LOG && LOG_VERBOSE) {
-		ttWrites ++;
-		if (entry->flag == FLAG_EMPTY) {
-			ttEntries ++;
-		} else if (entry->key == board->key) {
-			ttUpdates ++;
-		} else {
-			ttOverwrites ++;
-		}
+	// stats
+	iteration->ttWrites ++;
+
+	if (entry.flag == FLAG_EMPTY) {
+		ttEntries ++;
+	} else if (!found) {
+		iteration->ttOverwrites ++;
 	}
 
+	// account for mating distance
+	if (value > EVAL_WIN - MAX_LINE_LEN)
+		value += rootDist;
+
+	if (value < -EVAL_WIN + MAX_LINE_LEN)
+		value -= rootDist;
+
 	// overwrite otherwise
-	entry->key = board->key;
-	entry->depth = depth;
-	entry->foundAt = game->ply;
-	entry->flag = flag;
-	entry->value = value;
-	entry->move = move;
+	// if position is stored under its mirrored key, so is its move
+	Move stored = tt_mirrored() ? move.mirrored() : move;
+	Key* key = tt_key();
 
-	// account for mating distance
-	if (entry->value > EVAL_WIN - MAX_LINE_LEN)
-		entry->value += rootDist;
+	unsigned __int64 data = (unsigned __int64) (unsigned int) value << 32 | (unsigned __int64) stored.value << 16 | depth;
+	unsigned __int64 info = Bitboard::upper_word(key) << 24 | (unsigned __int64) flag << 16 | (u_short) game->ply;
 
-	if (entry->value < -EVAL_WIN + MAX_LINE_LEN)
-		entry->value -= rootDist;
+	TT* slot = tt_current();
+	std::atomic_ref<unsigned __int64>(slot->data).store(data, std::memory_order_relaxed);
+	std::atomic_ref<unsigned __int64>(slot->info).store(info, std::memory_order_relaxed);
+	std::atomic_ref<unsigned __int64>(slot->check).store(Bitboard::lower_word(key) ^ data ^ info, std::memory_order_relaxed);
 }
 
 // if a matching hash key is found in the transposition table
 // and if TT entry has a satisfactory depth
 // use TT information as opposed to a re-search
-int Bbot::tt_lookup(u_short depth, int alpha, int beta) {
+// hashMove: set to previously-found best move if entry can't be used, or if its exact value is used
+int Bbot::tt_lookup(u_short depth, int alpha, int beta, Move* hashMove) {
+	ProfileScope scope(PROFILE_TT_LOOKUP);
 
 	// current entry
-	TT* entry = tt_current();
+	TT_Entry entry;
+
+	iteration->ttProbes ++;
 
 	// if key doesn't match, return no-value flag
-	if (entry->key != board->key)
+	if (!tt_read(&entry))
 		return VALUE_UNKNOWN;
 
-	if constexpr (LOG && LOG_VERBOSE)
-		ttHits ++;
+	iteration->ttHits ++;
 
 	// if satisfactory depth, use value
-	if (entry->depth >= depth) {
+	if (entry.depth >= depth) {
 
 		// if flag is exact, use value verbatim
-		if (entry->flag == FLAG_EXACT) {
+		if (entry.flag == FLAG_EXACT) {
+			*hashMove = tt_move(&entry);
+
 			// account for mating distance
-			if (entry->value > EVAL_WIN - MAX_LINE_LEN)
-				return entry->value - rootDist;
+			if (entry.value > EVAL_WIN - MAX_LINE_LEN)
+				return entry.value - rootDist;
 
-			if (entry->value < -EVAL_WIN + MAX_LINE_LEN)
-				return entry->value + rootDist;
+			if (entry.value < -EVAL_WIN + MAX_LINE_LEN)
+				return entry.value + rootDist;
 
-			return entry->value;
+			return entry.value;
 		}
 
-		if (entry->flag == FLAG_STATIC)
-			return entry->value;
-
 		// if flag is alpha and search tree has seen better, give a fail-low result
-		if (entry->flag == FLAG_ALPHA && entry->value <= alpha)
+		if (entry.flag == FLAG_ALPHA && entry.value <= alpha)
 			return alpha;
 
 		// if flag is beta and search tree has seen better for opponent, give a fail-high result
-		if (entry->flag == FLAG_BETA && entry->value >= beta)
+		if (entry.flag == FLAG_BETA && entry.value >= beta)
 			return beta;
 	}
 		
 	// if not satisfactory depth or missing the cutoff, use previously-found best move to start search
 	// this improves move-ordering
-	if (entry->flag == FLAG_EXACT || entry->flag == FLAG_BETA) {
-		add_move(entry->move);
+	if (entry.flag == FLAG_EXACT || entry.flag == FLAG_BETA) {
+		*hashMove = tt_move(&entry);
 	}
 
 	return VALUE_UNKNOWN;
 }
 
-// get current transposition table entry
+// key of current position in the TT
+// with value tables, a position and its mirror have the same eval and share an entry under Board::ttKey
+// the network is not mirror-symmetric, so its positions are stored under their own key, as in eval_cached
+Key* Bbot::tt_key() {
+	return network == nullptr ? &board->ttKey : &board->key;
+}
+
+// true if current position is stored under its mirror's key, and so is its move
+bool Bbot::tt_mirrored() {
+	return network == nullptr && board->mirrored;
+}
+
+// get current transposition table entry, indexed by the hash of tt_key
 TT* Bbot::tt_current() {
-	return &transpositionTable[board->hash];
+	return &transpositionTable[(network == nullptr ? board->ttHash : board->hash) & ttMask];
 }
 
-// print TT entry
-void Bbot::tt_print(TT* entry) {
+// read current transposition table entry
+// entry is filled even if it belongs to another position, for the replacement test of tt_store
+// returns true if entry is of current position and was not torn by a concurrent write
+bool Bbot::tt_read(TT_Entry* entry) {
+	TT* slot = tt_current();
+	unsigned __int64 check = std::atomic_ref<unsigned __int64>(slot->check).load(std::memory_order_relaxed);
+	unsigned __int64 data = std::atomic_ref<unsigned __int64>(slot->data).load(std::memory_order_relaxed);
+	unsigned __int64 info = std::atomic_ref<unsigned __int64>(slot->info).load(std::memory_order_relaxed);
+
+	entry->value = (int) (data >> 32);
+	entry->move.value = (u_short) (data >> 16);
+	entry->depth = (u_short) data;
+	entry->flag = (Flag_TT) (info >> 16 & 0xFF);
+	entry->foundAt = (u_short) info;
+
+	return entry->flag != FLAG_EMPTY
+		&& (info >> 24) == Bitboard::upper_word(tt_key())
+		&& (check ^ data ^ info) == Bitboard::lower_word(tt_key());
+}
+
+// get move of TT entry, oriented to current position
+// only valid if entry matches current position
+Move Bbot::tt_move(TT_Entry* entry) {
+	return tt_mirrored() ? entry->move.mirrored() : entry->move;
+}
+
+// print TT entry of current position
+void Bbot::tt_print() {
 
-	string s = "KEY: " + std::to_string(board->hash);
-	s += "\nCOMPLETE: " + Bitboard::to_hex(board->key) + "\n";
+	string s = "KEY: " + std::to_string(network == nullptr ? board->ttHash : board->hash);
+	s += "\nCOMPLETE: " + Bitboard::to_hex(*tt_key()) + (tt_mirrored() ? " (MIRRORED)\n" : "\n");
 	
 	s += to_string() + "\n"; // game pos
 
+	TT_Entry entry;
 
-	if (entry->key == board->key) {
-		s += "DEPTH: " + std::to_string(entry->depth);
-		s += "\nFOUND AT GAME PLY: " + std::to_string(entry->foundAt);
+	if (tt_read(&entry)) {
+		s += "DEPTH: " + std::to_string(entry.depth);
+		s += "\nFOUND AT GAME PLY: " + std::to_string(entry.foundAt);
 		s += "\nFLAG: ";
 
-		switch (entry->flag) {
+		switch (entry.flag) {
 			case FLAG_EXACT: s += "EXACT"; break;
-			case FLAG_STATIC: s += "STATIC"; break;
 			case FLAG_ALPHA: s += "ALPHA"; break;
 			case FLAG_BETA: s += "BETA"; break;
 		}
 
-		s += "\nVALUE: " + std::to_string(entry->value);
-		s += "\nMOVE: " + entry->move.to_string(pointerBoard);
+		s += "\nVALUE: " + std::to_string(entry.value);
+		s += "\nMOVE: " + tt_move(&entry).to_string(pointerBoard);
 	} else {
 		s += "MISS";
 	}
@@ -342,18 +498,48 @@ void Bbot::tt_print(TT* entry) {
 	__PRINT(s + "\n");
 }
 
+// static eval of current position, from eval cache if it was evaluated before
+// with value tables, a position and its mirror have the same eval and share an entry, as in the TT
+// the network is not mirror-symmetric, so its evals are cached under the position's own key
+// the index checks the lower bits of the key and the entry checks bits 64-95, the rest are trusted
+int Bbot::eval_cached() {
+	bool mirrorShared = network == nullptr;
+	Key* key = mirrorShared ? &board->ttKey : &board->key;
+
+	unsigned __int64* entry = &evalCache[(mirrorShared ? board->ttHash : board->hash) & evalMask];
+	unsigned __int64 check = Bitboard::upper_word(key) << 32;
+
+	iteration->evalProbes ++;
+
+	// read once, as a single word
+	unsigned __int64 stored = *entry;
+
+	if (stored != 0 && (stored & 0xFFFFFFFF00000000ULL) == check) {
+		iteration->evalHits ++;
+		return (int32_t) (uint32_t) stored;
+	}
+
+	// always replace, evals of recent leaves are the most likely to be seen again
+	int value = evaluate();
+	*entry = check | (uint32_t) value;
+
+	return value;
+}
+
 ////
 
 // game history - used to quickly detect draws by repetition
 
 // store current key in linked list
-// head of list is stored in key's TT hash entry
+// head of list is stored in key's gh table entry
 void Bbot::gh_store() {
-	GH* gh = transpositionTable[board->hash].history;
+	ProfileScope scope(PROFILE_GH);
+
+	GH* gh = ghTable[board->hash & (GH_ALLOC - 1)];
 	
 	// if list is empty, create new head
 	if (gh == nullptr) {
-		transpositionTable[board->hash].history = new GH(board->key);
+		ghTable[board->hash & (GH_ALLOC - 1)] = new GH(board->key);
 		return;
 	}
 
@@ -367,15 +553,17 @@ void Bbot::gh_store() {
 
 // remove current key from memory
 void Bbot::gh_remove() {
-	GH* gh = transpositionTable[board->hash].history;
+	ProfileScope scope(PROFILE_GH);
+
+	GH* gh = ghTable[board->hash & (GH_ALLOC - 1)];
 
 	if (gh == nullptr)
 		return;
 
 	// delete if key matches head
 	if (gh->key == board->key) {
-		// connect TT entry's GH head to next node
-		transpositionTable[board->hash].history = gh->next;
+		// connect table entry's GH head to next node
+		ghTable[board->hash & (GH_ALLOC - 1)] = gh->next;
 		delete gh;
 		return;
 	}
@@ -400,11 +588,13 @@ void Bbot::gh_remove() {
 
 // returns true if position has been previously seen in game history or current line
 bool Bbot::gh_match() {
+	ProfileScope scope(PROFILE_GH);
+
 	// return false if in initial search position
 	if (rootDist == 0)
 		return false;
 
-	GH* gh = transpositionTable[board->hash].history;
+	GH* gh = ghTable[board->hash & (GH_ALLOC - 1)];
 
 	// scan list
 	while (gh != nullptr) {
@@ -438,90 +628,10 @@ void Bbot::gh_clear_played() {
 
 ////
 
-// for all pieces, expand moveBoard bboards and add to the move list in staged order
-// stages:
-// 1. moves to watering holes
-// 2. moves threatening opponent
-// 3. moves to watering hole row/col/diag
-// 4. all remaining moves
-void Bbot::add_legal_moves() {
-	bboard stagedmoveBoard;
-	Move move;
-	u_long scalar;
-	
-	// quickly update legal move sets
-	// doesn't properly clear forced pieces or opposite-colour pieces, but this is caught inside the loop
-	board->quick_move_sets();
-
-	for (int stage = 0; stage < 4; stage ++) {
-		for (Piece* p : pieces[board->sideToMove]) {
-
-			// if any piece is forced, only include forced pieces
-			if (board->isSideForced && !p->isForced)
-				continue;
-
-			// move set to be filtered
-			stagedmoveBoard = p->moveBoard;
-
-			// set 'from' in recorded move to current piece scalar
-			move.set_from(p->scalar);
-
-			// filter staged move set with stage's bboard
-			// then remove from original move set
-			if (stage == 0) {
-				// stage 1 - watering holes
-				stagedmoveBoard &= board->wateringHoles;
-				p->moveBoard ^= stagedmoveBoard;
-
-			} else if (stage == 1) {
-				// stage 2 - threats
-				stagedmoveBoard &= *(p->scaresMap);
-				p->moveBoard ^= stagedmoveBoard;
-
-			} else if (stage == 2) {
-				// stage 3 - wh row/col/diags
-				if (p->type == MOUSE) {
-					stagedmoveBoard &= whRowCol; // mice have row/col prioritized
-				} else if (p->type == LION) {
-					stagedmoveBoard &= whDiag[2]; // lions have diags prioritized
-				} else {
-					stagedmoveBoard &= whAllLines; // elephants have both prioritized
-				}
-
-				p->moveBoard ^= stagedmoveBoard;
-			}
-
-			// stage 4 - all remaining moves (no filter)
-
-			// serialize move set
-			// scanning in direction most likely to return a quick success
-			if (board->sideToMove == WHITE) {
-				// if white, scan forward
-				while (Bitboard::scan_forward(&scalar, &stagedmoveBoard)) {
-					stagedmoveBoard ^= Bitboard::SQUARES[scalar]; // remove found bit
-					move.set_to(scalar); // set destination
-					add_move(move); // add move
-				}
-
-			} else {
-				// if black, scan reverse
-				while (Bitboard::scan_reverse(&scalar, &stagedmoveBoard)) {
-					stagedmoveBoard ^= Bitboard::SQUARES[scalar]; // remove found bit
-					move.set_to(scalar); // set destination
-					add_move(move); // add move
-				}
-			}
-		}
-	}
-}
-
-// add move to pile
-void Bbot::add_move(Move move) {
-	moveList[toGenerate ++] = move;
-}
-
 // move piece on board
 void Bbot::make_move(Move move) {
+	ProfileScope scope(PROFILE_MAKE_MOVE);
+
 	int from = move.get_from();
 	int to = move.get_to();
 	Piece* p = pointerBoard[from];
@@ -536,6 +646,8 @@ void Bbot::make_move(Move move) {
 
 // make_move with 'from' and 'to' reversed
 void Bbot::unmake_move(Move move) {
+	ProfileScope scope(PROFILE_MAKE_MOVE);
+
 	int from = move.get_from();
 	int to = move.get_to();
 	Piece* p = pointerBoard[to];
@@ -566,10 +678,9 @@ void Bbot::traverse_backwards(Line* line, int dist) {
 // depth may be exceeded if a good TT node is hit
 // this is called repeatedly with increasing depth for iterative deepening
 void Bbot::search_fixed_depth(int depth) {
+	ProfileScope scope(PROFILE_SEARCH);
 
 	// set values
-	toGenerate = 0;
-	toPlay = 0;
 	rootDist = 0;
 	int value = 0;
 
@@ -602,15 +713,68 @@ void Bbot::search_fixed_depth(int depth) {
 		board->update_move_sets();
 	}
 
-	
-	// first search, with aspiration window
+
+	// search, with aspiration window
 	Line PVtemp;
-	value = search_alphabeta(depth, alpha, beta, &PVtemp);
+	value = search_root(depth, alpha, beta, &PVtemp);
 
 	// exit if search aborted
 	if (abs(value) == SEARCH_ABORTED)
 		return;
 
+	__DEBUG(PVtemp.length == 0 && PV.length == 0, "ERROR - PV and PVtemp were length 0");
+
+	// copy PV if newer PV found
+	if (PVtemp.length > 0)
+		PV = PVtemp;
+
+	// extend PV using TT
+	// - traverse PV and check resulting TT entry
+	// - if entry is exact and a high enough depth, it is satisfactory as a PV node
+	// - add to PV and repeat
+	// if successful, this can extend PVs past expected depth
+	traverse_forwards(&PV, PV.length);
+	TT_Entry entry;
+
+	// check if TT entry is useful
+	while (tt_read(&entry) && entry.flag == FLAG_EXACT && entry.depth >= depth - PV.length && PV.length < MAX_LINE_LEN
+		&& board->quick_is_legal(tt_move(&entry))) {
+
+		// add to PV
+		PV.append(tt_move(&entry));
+		make_move(tt_move(&entry));
+	}
+
+	// traverse back to root
+	traverse_backwards(&PV, PV.length);
+
+	// set eval
+	if (abs(value) != SEARCH_ABORTED)
+		eval = board->sideToMove ? -value : value;
+
+	// set depth
+	tt_read(&entry);
+	searchDepth = (std::max)(depth, (int) entry.depth);
+	iteration->completed = true;
+
+	// next best lines
+	search_multi_pv(depth);
+
+	// set duration
+	searchDuration = (double) search_clock() / 1000;
+}
+
+// search root to depth within aspiration window [alpha, beta], searching again with wider bounds if the result falls outside
+// returns value for side to move, or SEARCH_ABORTED
+int Bbot::search_root(int depth, int alpha, int beta, Line* line) {
+
+	// first search, with aspiration window
+	int value = search_alphabeta(depth, alpha, beta, line);
+
+	// exit if search aborted
+	if (abs(value) == SEARCH_ABORTED)
+		return value;
+
 	// if value falls outside aspiration window, a re-search is required
 	// we know that the search failed in one direction or another, so we can search just below or just above our previous bounds
 	// i.e., if we fail low on [alpha, beta], search [-infinity, alpha]
@@ -618,82 +782,94 @@ void Bbot::search_fixed_depth(int depth) {
 
 	// search fails low
 	if (value <= alpha) {
-		__LOG_VERBOSE(format("      FAIL LOW on [{}, {}]", alpha, beta));
+		__LOG_VERBOSE("      FAIL LOW on [{}, {}]", alpha, beta);
 
 		beta = alpha;
 		alpha = -INT_MAX;
-		PVtemp.length = 0;
+		line->length = 0;
+		iteration->failLows ++;
 
 		board->update_move_sets();
-		value = search_alphabeta(depth, alpha, beta, &PVtemp);
+		value = search_alphabeta(depth, alpha, beta, line);
 
 	} else if (value >= beta) {
 		
 		// search fails high
-		__LOG_VERBOSE(format("      FAIL HIGH on [{}, {}]", alpha, beta));
+		__LOG_VERBOSE("      FAIL HIGH on [{}, {}]", alpha, beta);
 
 		alpha = beta;
 		beta = INT_MAX;
-		PVtemp.length = 0;
+		line->length = 0;
+		iteration->failHighs ++;
 
 		board->update_move_sets();
-		value = search_alphabeta(depth, alpha, beta, &PVtemp);
+		value = search_alphabeta(depth, alpha, beta, line);
 	}
 
 	// exit if search aborted
 	if (abs(value) == SEARCH_ABORTED)
-		return;
+		return value;
 
 	// rarely, a search may fail a second time
 	if (value <= alpha || value >= beta) {
-		__LOG_VERBOSE(value <= alpha, format("      2ND FAIL - LOW on [{}, {}]", alpha, beta));
-		__LOG_VERBOSE(value >= beta, format("      2ND FAIL - HIGH on [{}, {}]", alpha, beta));
+		if (value <= alpha)
+			__LOG_VERBOSE("      2ND FAIL - LOW on [{}, {}]", alpha, beta);
+
+		if (value >= beta)
+			__LOG_VERBOSE("      2ND FAIL - HIGH on [{}, {}]", alpha, beta);
+
+		value <= alpha ? iteration->failLows ++ : iteration->failHighs ++;
 
 		board->update_move_sets();
-		PVtemp.length = 0;
-		value = search_alphabeta(depth, -INT_MAX, INT_MAX, &PVtemp);
+		line->length = 0;
+		value = search_alphabeta(depth, -INT_MAX, INT_MAX, line);
 	}
 
-	// exit if search aborted
-	if (abs(value) == SEARCH_ABORTED)
-		return;
+	return value;
+}
 
-	__DEBUG(PVtemp.length == 0 && PV.length == 0, "ERROR - PV and PVtemp were length 0");
+// search root again for each next best line, excluding the first moves of lines already found, until multiPV lines are found
+// later passes find most of their tree in the TT filled by the first, so each costs a fraction of it
+// if a pass is aborted, lines of the previous iteration fill in for the ones not found
+void Bbot::search_multi_pv(int depth) {
+	vector<PVLine> found = { { PV, eval } };
 
-	// copy PV if newer PV found
-	if (PVtemp.length > 0)
-		PV = PVtemp;
+	for (int i = 1; i < multiPV; i ++) {
+		rootExcluded.push_back(found.back().line.get_move(0));
 
-	// extend PV using TT
-	// - traverse PV and check resulting TT entry
-	// - if entry is exact and a high enough depth, it is satisfactory as a PV node
-	// - add to PV and repeat
-	// if successful, this can extend PVs past expected depth
-	traverse_forwards(&PV, PV.length);
-	TT* entry = tt_current();
+		// aspiration window around value of this line in the previous iteration, if any
+		int alpha = -INT_MAX;
+		int beta = INT_MAX;
 
-	// check if TT entry is useful
-	while (entry->key == board->key && entry->flag == FLAG_EXACT && entry->depth >= depth - PV.length && PV.length < MAX_LINE_LEN) {
-		//__DEBUG(pointerBoard[entry->move.get_from()] == nullptr, "Move " + entry->move.to_string(pointerBoard) + " had no piece at origin.");
+		if (i < (int) lines.size()) {
+			int previous = board->sideToMove ? -lines[i].eval : lines[i].eval;
+			alpha = previous - ASPIRATION_WINDOW;
+			beta = previous + ASPIRATION_WINDOW;
+		}
 
-		// add to PV
-		PV.append(entry->move);
-		make_move(entry->move);
-		entry = tt_current();
+		board->update_move_sets();
+
+		Line line;
+		int value = search_root(depth, alpha, beta, &line);
+
+		// exit if aborted, or if no root moves remain
+		if (abs(value) == SEARCH_ABORTED || line.length == 0)
+			break;
+
+		found.push_back({ line, board->sideToMove ? -value : value });
 	}
 
-	// traverse back to root
-	traverse_backwards(&PV, PV.length);
+	rootExcluded.clear();
 
-	// set eval
-	if (abs(value) != SEARCH_ABORTED)
-		eval = board->sideToMove ? -value : value;
+	for (PVLine& previous : lines) {
+		if ((int) found.size() >= multiPV)
+			break;
 
-	// set depth
-	searchDepth = (std::max)(depth, (int) tt_current()->depth);
+		if (std::none_of(found.begin(), found.end(), [&](PVLine& l) { return l.line.get_move(0) == previous.line.get_move(0); }))
+			found.push_back(previous);
+	}
 
-	// set duration
-	searchDuration = (double) search_clock() / CLOCKS_PER_SEC;
+	lines = found;
 }
 
 // SEARCH TREE
@@ -705,17 +881,22 @@ void Bbot::search_fixed_depth(int depth) {
 int Bbot::search_alphabeta(int depth, int alpha, int beta, Line* line) {
 
 	// if allotted time is exceeded, return unknown value flag
-	if (search_clock() > allottedTime && searchDepth > 0)
+	if (search_clock() > std::atomic_ref<long long>(allottedTime).load(std::memory_order_relaxed) && searchDepth > 0)
 		return SEARCH_ABORTED;
 
-	if constexpr (LOG)
-		nodesVisited ++;
+	nodesVisited ++;
+	iteration->nodes ++;
 
 	// set values
 	int value;
 	Flag_TT flag = FLAG_ALPHA; // if no flag is set, then all moves must have failed low and an ALPHA flag is stored in TT
 	Line branch;
 	Move move;
+	Move hashMove;
+
+	// root of a MultiPV pass, searched without its excluded moves
+	// its TT entry holds the best move, so it is neither used nor replaced
+	bool excluding = rootDist == 0 && !rootExcluded.empty();
 
 	// check if game lost
 	if (game->game_lost())
@@ -725,13 +906,29 @@ int Bbot::search_alphabeta(int depth, int alpha, int beta, Line* line) {
 	if (gh_match())
 		return rootDist % 2 ? -EVAL_DRAW : EVAL_DRAW;
 
+	// check for a win on this move, before any tt lookup or move generation
+	// winning move is recorded, unless line is already at its maximum length
+	if (!excluding && rootDist < MAX_LINE_LEN && board->find_winning_move(&move)) {
+		line->moves[0] = move;
+		line->length = 1;
+
+		return EVAL_WIN - rootDist - 1;
+	}
+
+	// if opponent threatens to win, static eval can't be trusted at this node
+	// extend by one ply so the threat is resolved by the check above in each child
+	// replies that leave the threat open are then refuted without expansion
+	if (depth == 0 && rootDist < MAX_LINE_LEN - 1 && board->threatens_win(SIDES[!board->sideToMove]))
+		depth = 1;
+
 	// check tt
 	// if value is returned, use instead of current search
-	if ((value = tt_lookup(depth, alpha, beta)) != VALUE_UNKNOWN) {
+	if ((value = tt_lookup(depth, alpha, beta, &hashMove)) != VALUE_UNKNOWN && !excluding) {
+		iteration->ttUsableHits ++;
 
-		// if move exists, add to line
-		if (tt_current()->flag == FLAG_EXACT) {
-			line->moves[0] = tt_current()->move;
+		// if value is exact, add its move to line
+		if (hashMove.value != 0) {
+			line->moves[0] = hashMove;
 			line->length = 1;
 		}
 
@@ -739,45 +936,39 @@ int Bbot::search_alphabeta(int depth, int alpha, int beta, Line* line) {
 	}
 
 	// if depth 0, do static eval
-	if (depth == 0) {
-		value = evaluate();
-
-		tt_store(depth, FLAG_STATIC, value, 0);
-
-		return value;
-	}
+	// leaf evals go to the eval cache, so the TT only holds search results
+	if (depth == 0)
+		return eval_cached();
 
 	// store position in TT game history
 	gh_store();
 
-	// add all legal moves to moveList
-	add_legal_moves();
+	// moves are generated lazily in stages, starting with the hash move
+	// picker lives on the stack, one per ply
+	MovePicker picker;
+	picker.init(board, hashMove, whLines, valueTable, THREAT_SCORE);
 
-	int temp1, temp2;
+	Move next;
+	int numSearched = 0;
 
 	// loop until no more moves to play
-	while (toPlay < toGenerate) {
+	while (picker.next(&next)) {
+		if (excluding && std::find(rootExcluded.begin(), rootExcluded.end(), next) != rootExcluded.end())
+			continue;
+
+		numSearched ++;
 
 		// clear branch
 		branch.length = 0;
 
-		// remember current moveList indices
-		temp1 = toPlay;
-		temp2 = toGenerate;
-
 		// make move
-		make_move(moveList[toPlay]);
-
-		// search children
-		toPlay = toGenerate;
+		make_move(next);
 
 		// recursive alphabeta search
 		value = -search_alphabeta(depth - 1, -beta, -alpha, &branch);
 
 		// undo move
-		toPlay = temp1;
-		toGenerate = temp2;
-		unmake_move(moveList[toPlay]);
+		unmake_move(next);
 
 		// if search aborted (time exceeded) then exit
 		if (value == -SEARCH_ABORTED) {
@@ -787,8 +978,14 @@ int Bbot::search_alphabeta(int depth, int alpha, int beta, Line* line) {
 
 		// fails high
 		if (value >= beta) {
+			iteration->cutoffs ++;
+
+			if (numSearched == 1)
+				iteration->firstMoveCutoffs ++;
+
 			// store move in TT
-			tt_store(depth, FLAG_BETA, beta, moveList[toPlay]);
+			if (!excluding)
+				tt_store(depth, FLAG_BETA, beta, next);
 
 			// remove position from game history
 			gh_remove();
@@ -804,21 +1001,19 @@ int Bbot::search_alphabeta(int depth, int alpha, int beta, Line* line) {
 
 			// last/most successful move will be stored with an EXACT flag in TT
 			flag = FLAG_EXACT;
-			move = moveList[toPlay];
+			move = next;
 
 			// copy successful branch to PV line
 			line->moves[0] = move;
 			memcpy(line->moves + 1, branch.moves, branch.length * sizeof(Move));
 			line->length = branch.length + 1;
 		}
-
-		// iterate to next move
-		toPlay ++;
 	}
 
 	// if flag is alpha, failed low
 	// if flag is exact, succeeded high
-	tt_store(depth, flag, alpha, move);
+	if (!excluding)
+		tt_store(depth, flag, alpha, move);
 
 	// remove position from game history
 	gh_remove();
@@ -828,9 +1023,37 @@ int Bbot::search_alphabeta(int depth, int alpha, int beta, Line* line) {
 	return alpha;
 }
 
-// time since search initiated
-std::clock_t Bbot::search_clock() {
-	return std::clock() - startClock;
+// look up current position in opening book
+// if found, book move is used as PV and search is skipped
+bool Bbot::search_book() {
+	Move move;
+	int value;
+	bool found = book.probe(board, &move, &value);
+
+	// verifying book move may leave move sets partially updated
+	board->update_move_sets();
+
+	if (!found)
+		return false;
+
+	PV.length = 0;
+	PV.append(move);
+	eval = value;
+	lines = { { PV, eval } };
+
+	searchDepth = 0;
+	searchDuration = 0;
+	nodesVisited = 0;
+	stats.depths.clear();
+
+	__LOG("[{}]: BOOK MOVE {} (EVAL {})", SIDE_NAMES[board->sideToMove], board->move_to_string(move), search_eval());
+
+	return true;
+}
+
+// time since search initiated (ms)
+long long Bbot::search_clock() {
+	return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startClock).count();
 }
 
 // check condition and end search if true
@@ -838,12 +1061,9 @@ bool Bbot::search_exit(bool condition, string message) {
 	if (!condition)
 		return false;
 
-	__LOG("   SEARCH EXITED - " + message);
-	__LOG_VERBOSE(format("      {} nodes visited", nodesVisited));
-	__LOG_VERBOSE(format("      {} hits, {} writes, {} updates, {} overwrites", ttHits, ttWrites, ttUpdates, ttOverwrites));
-	__LOG_VERBOSE(format("      TABLE: [{} / {}] ({:.2f}% Full)", ttEntries, TT_ALLOC, (float) ttEntries / TT_ALLOC * 100));
-
-	//__PRINT_CHART();
+	__LOG("   SEARCH EXITED - {}", message);
+	__LOG_VERBOSE("      {} nodes visited", nodesVisited);
+	__LOG_VERBOSE("      TABLE: [{} / {}] ({:.2f}% Full)", ttEntries, TT_ALLOC, (float) ttEntries / TT_ALLOC * 100);
 
 	searching = false;
 
@@ -863,12 +1083,22 @@ void Bbot::init_eval_boards() {
 	whDiag[2] = whDiag[0] | whDiag[1];
 	whAllLines = whRowCol | whDiag[2];
 
-	// create valueTable from scoring parameters
+	// move ordering priority by piece type
+	whLines[MOUSE] = whRowCol; // mice have row/col prioritized
+	whLines[LION] = whDiag[2]; // lions have diags prioritized
+	whLines[ELEPHANT] = whAllLines; // elephants have both prioritized
+
+	init_value_table();
+}
+
+// create valueTable from scoring parameters
+// must be called again if parameters are changed
+void Bbot::init_value_table() {
 	for (int i = 0; i < NUM_SQUARES; i ++) {
 		for (int j = 0; j < NUM_TILE_GROUPS; j ++)
 			if (tileGroups[j][i])
 				for (PieceType t : PIECE_TYPES)
-					valueTable[t][i] = TILE_GROUP_SCORE[t];
+					valueTable[t][i] = TILE_GROUP_SCORE[j];
 
 		if (whRowCol[i]) {
 			valueTable[MOUSE][i] += ON_WH_ROW_COL_SCORE;
@@ -893,11 +1123,22 @@ void Bbot::init_eval_boards() {
 
 // STATIC EVALUATION
 // evaluates position at terminal node
-// - considers valueTables and piece threats
+// - considers valueTables, piece threats and activity, or the network if one is loaded
 // - positive if favouring side to move
 // - equal and opposite scoring is calculated for opponent, so score may be negative or 0 (if equal)
 
 int Bbot::evaluate() {
+	ProfileScope scope(PROFILE_EVAL);
+
+	// network, once attached to board by search
+	// kept below mate values, and learns the advantage of the side to move itself
+	if (network && board->network == network.get()) {
+		int limit = EVAL_WIN - MAX_LINE_LEN - 1;
+		return std::clamp(network->evaluate(board->accumulator, SIDES[board->sideToMove]), -limit, limit);
+	}
+
+	// safe squares of pieces whose sight or threats changed
+	board->update_safe_squares();
 
 	// white pieces
 	int value = 0;
@@ -905,6 +1146,8 @@ int Bbot::evaluate() {
 		value += valueTable[p->type][p->scalar];
 		if (p->isThreatened)
 			value -= THREAT_SCORE;
+
+		value += piece_activity(p);
 	}
 
 	// black pieces
@@ -912,6 +1155,8 @@ int Bbot::evaluate() {
 		value -= valueTable[p->type][p->scalar];
 		if (p->isThreatened)
 			value += THREAT_SCORE;
+
+		value -= piece_activity(p);
 	}
 
 	value = (board->sideToMove ? -value : value);
@@ -923,6 +1168,47 @@ int Bbot::evaluate() {
 	return value;
 }
 
+// empty eval cache, if allocated
+// call after changing evaluation parameters, e.g. through eval_params, as cached evals are of the old ones
+void Bbot::clear_eval_cache() {
+	if (evalCache != nullptr)
+		std::fill(evalCache, evalCache + EVAL_CACHE_ALLOC, 0);
+}
+
+// mobility, trapped, and watering hole reach scores of piece
+// counted over its safe squares: squares it sees, which are empty, and where it would not be scared, see Board::update_safe_squares
+// a piece boxed in by scaring herds has none, whether or not it is threatened
+int Bbot::piece_activity(Piece* p) {
+	int value = MOBILITY_SCORE * p->safeSquares + WH_REACH_SCORE * p->safeWH;
+
+	if (p->safeSquares == 0)
+		value -= TRAPPED_SCORE;
+
+	return value;
+}
+
+// parameters of evaluate that may be tuned
+// evaluate must stay linear in all of these, see Tuner
+vector<EvalParam> Bbot::eval_params() {
+	vector<EvalParam> params;
+
+	for (int i = 0; i < NUM_TILE_GROUPS; i ++)
+		params.push_back({ "TILE_GROUP_SCORE", i, &TILE_GROUP_SCORE[i] });
+
+	params.push_back({ "ON_WH_ROW_COL_SCORE", -1, &ON_WH_ROW_COL_SCORE });
+
+	for (int i = 0; i < 2; i ++)
+		params.push_back({ "ON_WH_DIAG_SCORE", i, &ON_WH_DIAG_SCORE[i] });
+
+	params.push_back({ "THREAT_SCORE", -1, &THREAT_SCORE });
+	params.push_back({ "MOBILITY_SCORE", -1, &MOBILITY_SCORE });
+	params.push_back({ "TRAPPED_SCORE", -1, &TRAPPED_SCORE });
+	params.push_back({ "WH_REACH_SCORE", -1, &WH_REACH_SCORE });
+	params.push_back({ "TO_MOVE_SCORE", -1, &TO_MOVE_SCORE });
+
+	return params;
+}
+
 // true if value represents a forced mate for either colour
 bool Bbot::is_mate_eval(int value) {
 	return abs(value) > EVAL_WIN - MAX_LINE_LEN;
@@ -930,6 +1216,22 @@ bool Bbot::is_mate_eval(int value) {
 	
 ////
 
+// eval to string, positive if favouring white
+// 1.0 = +1 watering hole advantage, or +/-Mn for a forced win in n moves
+string Bbot::eval_to_string(int value) {
+
+	// white to mate
+	if (value >= EVAL_WIN - MAX_LINE_LEN)
+		return format("+M{}", (EVAL_WIN - value + 1) / NUM_SIDES);
+
+	// black to mate
+	if (value <= -EVAL_WIN + MAX_LINE_LEN)
+		return format("-M{}", (EVAL_WIN + value + 1) / NUM_SIDES);
+
+	// non-mate eval
+	return format("{:+.3f}", (float) value / ON_WH_SCORE[0]);
+}
+
 // current position to string
 string Bbot::to_string() {
 	return board->to_string();
@@ -942,20 +1244,6 @@ void Bbot::print() {
 
 ////
 
-// add time since last clock to time distribution array at i, used for optimization
-void Bbot::__CHART_TIME(int index) {
-	timeDistribution[index] += std::clock() - lastClock;
-	lastClock = std::clock();
-}
-
-// print time distribution
-void Bbot::__PRINT_CHART() {
-	__LOG("TIME CHART:");
-
-	for (int i = 0; i < timeDistCats.size(); i ++)
-		__LOG(format("   {}: {:1f} ms", timeDistCats[i], (double) timeDistribution[i] / CLOCKS_PER_SEC * 1000));
-}
-
 // print info about current state, used in debug
 void Bbot::__DEBUG(bool condition, string message) {
 	if constexpr (DEBUG)
@@ -966,4 +1254,35 @@ void Bbot::__DEBUG(bool condition, string message) {
 		board->__DEBUG(condition, message);
 }
 
+////////////////////////////////
+
+// SearchStats //
+
+// one line of stats of iteration i
+string SearchStats::to_string(size_t i) const {
+	const DepthStats& d = depths[i];
+	double ebf = i > 0 ? d.branching_factor(depths[i - 1]) : 0;
+
+	return format("{} nodes, EBF {:.2f}, first move cutoffs {:.1f}%, TT hits {:.1f}% ({:.1f}% usable), {} overwrites, eval cache hits {:.1f}%, fail high/low {}/{}{}",
+		d.nodes, ebf, d.first_move_cutoff_rate() * 100, d.tt_hit_rate() * 100, d.tt_usable_rate() * 100, d.ttOverwrites,
+		d.eval_hit_rate() * 100, d.failHighs, d.failLows, d.completed ? "" : " (aborted)");
+}
+
+// array of stats of every iteration as JSON, time in ms
+string SearchStats::to_json() const {
+	string s = "[";
+
+	for (size_t i = 0; i < depths.size(); i ++) {
+		const DepthStats& d = depths[i];
+		double ebf = i > 0 ? d.branching_factor(depths[i - 1]) : 0;
+
+		s += (i > 0 ? ", {" : "{") + format("\"depth\": {}, \"completed\": {}, \"nodes\": {}, \"ebf\": {:.3f}, \"first_move_cutoffs\": {:.4f}, "
+			"\"tt_hits\": {:.4f}, \"tt_usable_hits\": {:.4f}, \"tt_overwrites\": {}, \"eval_cache_hits\": {:.4f}, \"fail_highs\": {}, \"fail_lows\": {}, \"time\": {:.3f}",
+			d.depth, d.completed, d.nodes, ebf, d.first_move_cutoff_rate(), d.tt_hit_rate(), d.tt_usable_rate(), d.ttOverwrites,
+			d.eval_hit_rate(), d.failHighs, d.failLows, d.time * 1000) + "}";
+	}
+
+	return s + "]";
+}
+
 } // end namespace Bbot2
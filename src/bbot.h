@@ -3,7 +3,8 @@
 // a chess variant engine built to play Barca, a board game by Andrew Caldwell
 // this engine uses bitboard-lookup move generation, a negamax alphabeta search tree, and iterative deepening
 // within the tree, it utilizes a transposition table with no hash collision resolution
-// there is collision resolution exclusively for a game history linked list within the TT to detect draws
+// game history is kept apart from the TT, in a hash table of linked lists used to detect draws
+// so several engines may share one TT while each follows its own game
 // many chess programming techniques are adapted to fit to the alternate rule-set and 10x10 board
 
 // a score of +1.0 is equivalent to a 1 watering hole advantage to white
@@ -11,8 +12,6 @@
 
 // TODO:
 // Multi-threading (Lazy SMP)
-// Automated parameter tuning
-// Opening book
 
 #pragma once
 
@@ -23,8 +22,15 @@
 #include "piece.h"
 #include "move.h"
 #include "line.h"
+#include "movepicker.h"
 #include "bitboard.h"
-#include <ctime>
+#include "book.h"
+#include "profile.h"
+#include "engine.h"
+#include "nnue.h"
+#include <chrono>
+#include <atomic>
+#include <memory>
 
 
 namespace Bbot2 {
@@ -33,23 +39,101 @@ class Game;
 
 struct GH;
 
-enum Flag_TT: u_byte { FLAG_EMPTY, FLAG_EXACT, FLAG_STATIC, FLAG_ALPHA, FLAG_BETA };
+// tunable evaluation parameter, see Tuner
+// index is -1 for a scalar, otherwise the array index of value
+typedef struct EvalParam {
+	std::string name;
+	int index;
+	int* value;
 
-// transposition table entry
-// hash table using zobrist key as key and modulus for hash function
-// no hash collision
-typedef struct TT {
-	Key key;
+	// key in [EVALUATION] section of .ini, e.g. TILE_GROUP_SCORE[2] -> tile-group-score-2
+	std::string ini_key() {
+		std::string key = name;
+		std::transform(key.begin(), key.end(), key.begin(), [](char c) { return c == '_' ? '-' : (char) std::tolower(c); });
+
+		return index >= 0 ? key + "-" + std::to_string(index) : key;
+	}
+} EvalParam;
+
+enum Flag_TT: u_byte { FLAG_EMPTY, FLAG_EXACT, FLAG_ALPHA, FLAG_BETA };
+
+// transposition table entry, as read from the table by tt_read
+typedef struct TT_Entry {
 	u_short depth = 0;
-	Flag_TT flag = FLAG_EMPTY; // EMPTY, EXACT, STATIC, ALPHA, or BETA
-	int value; // evaluation
+	Flag_TT flag = FLAG_EMPTY; // EMPTY, EXACT, ALPHA, or BETA
+	int value = 0; // evaluation
 	Move move; // recommended move
 	u_short foundAt = 0; // start ply of search at which entry was stored. used to factor recency 
-	GH* history = nullptr; // gh head
+} TT_Entry;
+
+// transposition table entry, as stored
+// hash table using zobrist key as key and modulus for hash function
+// packed into words that are each read and written atomically, so an entry can be checked for a torn write
+// - data: value, move, and depth
+// - info: upper word of key, flag, and foundAt
+// - check: lower word of key xor data and info
+typedef struct TT {
+	unsigned __int64 check = 0;
+	unsigned __int64 data = 0;
+	unsigned __int64 info = 0;
 } TT;
 
+// counters of one iteration of iterative deepening, see Bbot::search_stats
+typedef struct DepthStats {
+	int depth = 0;
+	bool completed = false; // false if aborted by time limit
+	double time = 0; // s, of this iteration
+
+	unsigned __int64 nodes = 0;
+
+	// beta cutoffs in the tree, and how many came from the first move searched
+	unsigned __int64 cutoffs = 0;
+	unsigned __int64 firstMoveCutoffs = 0;
+
+	// TT lookups, how many found their position, and how many of those returned a value in place of a search
+	unsigned __int64 ttProbes = 0;
+	unsigned __int64 ttHits = 0;
+	unsigned __int64 ttUsableHits = 0;
+
+	// TT stores, and how many replaced an entry of another position
+	unsigned __int64 ttWrites = 0;
+	unsigned __int64 ttOverwrites = 0;
+
+	// static evals at leaves, and how many were found in the eval cache
+	unsigned __int64 evalProbes = 0;
+	unsigned __int64 evalHits = 0;
+
+	// re-searches after the aspiration window failed
+	int failHighs = 0;
+	int failLows = 0;
+
+	// ratios, 0 if undefined
+	// branching factor is per ply, as an iteration may skip depths reached through the TT
+	double branching_factor(const DepthStats& previous) const {
+		return previous.nodes > 0 && depth > previous.depth ? std::pow((double) nodes / previous.nodes, 1.0 / (depth - previous.depth)) : 0;
+	}
+	double first_move_cutoff_rate() const { return cutoffs > 0 ? (double) firstMoveCutoffs / cutoffs : 0; }
+	double tt_hit_rate() const { return ttProbes > 0 ? (double) ttHits / ttProbes : 0; }
+	double tt_usable_rate() const { return ttProbes > 0 ? (double) ttUsableHits / ttProbes : 0; }
+	double eval_hit_rate() const { return evalProbes > 0 ? (double) evalHits / evalProbes : 0; }
+} DepthStats;
+
+// line of a MultiPV search, see Bbot::multiPV
+typedef struct PVLine {
+	Line line;
+	int eval; // positive if favouring white
+} PVLine;
+
+// statistics of the most recent search, one DepthStats per iteration
+typedef struct SearchStats {
+	std::vector<DepthStats> depths;
+
+	std::string to_string(size_t i) const;
+	std::string to_json() const;
+} SearchStats;
+
 // Bbot
-class Bbot {
+class Bbot : public Engine {
 	////
 
 	//// SCORING PARAMETERS ////
@@ -66,6 +150,10 @@ class Bbot {
 
 	int THREAT_SCORE = 5000; // subtracted for every piece side has threatened
 
+	int MOBILITY_SCORE = 200; // for every square a piece can move to without being scared
+	int TRAPPED_SCORE = 5000; // subtracted for every piece with no such square
+	int WH_REACH_SCORE = 2500; // for every free watering hole a piece can move to without being scared
+
 	int TO_MOVE_SCORE = 1000; // to minimize score oscillation, this advantage is given for the player to move
 
 	//// SEARCH PARAMETERS ////
@@ -73,12 +161,19 @@ class Bbot {
 	int ASPIRATION_WINDOW = 5000; // the width of bounds for the first search
 	// a narrow window is initially faster, but more likely to fail, requiring a re-search
 
-	//// MEMORY ////
+	// size of transposition table
+	// larger values give better performance at a higher memory demand
+	// rounded up to form 2^n for hashing purposes
+	u_long TT_ALLOC = 1 << 20;
 
-	// size of FILO array of moves to play within search
-	// entries are quickly rewritten and stay low, only reach higher indices at higher depths
-	// does not impact performance, but will cause errors if set too low
-	static const int MOVE_LIST_ALLOC = 2048;
+	// size of eval cache, static evals of leaves kept apart from the TT
+	// small enough to stay in L2/L3 cache, as it is probed at every leaf. rounded up to form 2^n
+	u_long EVAL_CACHE_ALLOC = 1 << 16;
+
+	// size of game history table. only holds positions of the current game and line, so may be small
+	static const u_long GH_ALLOC = 1 << 12;
+
+	// usually overrided by .ini in settings()
 
 	////
 
@@ -174,6 +269,7 @@ class Bbot {
 	bboard whRowCol; // all squares that see a wh on a row/col
 	bboard whDiag[3]; // on a diagonal, [0] sees one wh, [1] sees two wh, and [2] = [0] | [1]
 	bboard whAllLines; // all squares that see a wh on their row/col/diag
+	bboard whLines[NUM_TYPES]; // wh lines prioritized by each piece type: row/col for mice, diags for lions, all for elephants
 	int valueTable[NUM_TYPES][NUM_SQUARES]; // piece/square value table used for evaluation
 
 	Game* game; // attached game
@@ -182,10 +278,17 @@ class Bbot {
 	Piece** pointerBoard; // from board - array of pointers where a piece is indexed by its scalar, nullptr if square is empty
 
 	TT* transpositionTable; // hash table, size of TT_ALLOC
+	u_long ttMask; // masks Board::ttHash, or Board::hash if a network is loaded, to TT index (see tt_key)
+	bool ttShared = false; // if true, table is owned elsewhere, see share_tt
+
+	// eval cache, size of EVAL_CACHE_ALLOC, indexed by Board::ttHash, or Board::hash if a network is loaded (see eval_cached)
+	// an entry is one word: upper 32 bits verify the key (bits 64-95), lower 32 bits hold the eval for the side to move
+	// so it is read and written whole, without locks. 0 if empty
+	unsigned __int64* evalCache = nullptr;
+	u_long evalMask; // masks hash to eval cache index
+
+	GH* ghTable[GH_ALLOC] = {}; // gh heads, indexed by Board::hash
 
-	Move moveList[MOVE_LIST_ALLOC]; // FILO array used to store all moves to be played
-	int toGenerate = 0; // index of next move to be generated
-	int toPlay = 0; // index of next move to be played
 	int rootDist = 0; // distance from root. increments up within search tree while depth decrements
 
 	const int VALUE_UNKNOWN = INT_MAX - 1; // flag for no TT lookup value
@@ -194,86 +297,121 @@ class Bbot {
 	Line PV; // principal variation
 	int eval; // final evaluation
 
+	std::vector<PVLine> lines; // best lines with their evals, PV first. multiPV of them once an iteration completes
+	std::vector<Move> rootExcluded; // root moves skipped by search_alphabeta, the first moves of lines already found
+
 	int searching = false; // is search ongoing
 	int searchDepth = 0; // max depth successfully reached in current search
 	double searchDuration; // total time taken by most recent search
 
-	std::clock_t startClock; // set when search is started
-	std::clock_t allottedTime; // time limit for search
+	// wall clock, as std::clock counts cpu time of all threads on some platforms
+	std::chrono::steady_clock::time_point startClock; // set when search is started
+	// time limit for search (ms)
+	// accessed through std::atomic_ref, so search_abort may be called from another thread, while Bbot stays copyable
+	alignas(std::atomic_ref<long long>::required_alignment) long long allottedTime = 0;
 
-	// __CHART_TIME
-	std::clock_t timeDistribution[5] = { 0, 0, 0, 0, 0 };
-	std::clock_t lastClock;
-	std::vector<std::string> timeDistCats{ "MOVE GEN", "STATIC EVAL", "TT", "GH", "MOVES" };
+	std::string bookFile = ""; // opening book, none if empty
+	Book book;
 
+	std::string networkFile = ""; // neural network evaluation, see nnue.h. value tables are used if empty
+	std::shared_ptr<Nnue> network; // loaded by init, shared by copies of engine
 
+	unsigned __int64 nodesVisited = 0; // nodes searched by most recent search
 
-	// log values
-	int nodesVisited = 0;
-	int ttEntries = 0;
-	int ttWrites = 0;
-	int ttHits = 0;
-	int ttUpdates = 0;
-	int ttOverwrites = 0;
+	SearchStats stats; // of most recent search
+	DepthStats* iteration = nullptr; // counters of current iteration, last of stats.depths
+
+	int ttEntries = 0; // filled entries, only counted by this engine if TT is shared
 
 public:
 	bool initialized = false;
 
-	Bbot(Game* game_);
+	// lines searched per iteration, each excluding the first moves of the ones before
+	// set by analysis. players in a game only search 1
+	int multiPV = 1;
 
-	void init();
-	void attach_game(Game* game_);
-	void release_game();
+	// if false, the opening book in .ini is not mapped and every position is searched
+	// set by the book builder, which may be rebuilding that book
+	bool useBook = true;
 
-	bool search(int maxTime, int maxDepth);
-	void search_abort();
+	Bbot(Game* game_);
 
-	void on_move_played(Move move);
+	void settings(CSimpleIniA* config) override;
+	void share_tt(TT* table, u_long size);
+	void init() override;
+	void init_eval_boards();
+	void init_value_table();
+	void attach_game(Game* game_) override;
+	void release_game() override;
+
+	bool search(int maxTime, int maxDepth) override;
+	void search_abort() override;
+
+	void on_move_played(Move move) override;
+
+	std::string search_eval() override;
+	std::string search_PV() override;
+	int search_num_lines();
+	std::string search_eval(int i);
+	std::string search_PV(int i);
+	bool search_ongoing() override;
+	int search_depth() override;
+	int search_value();
+	float search_score() override;
+	double search_duration() override;
+	int search_speed() override;
+	unsigned __int64 search_nodes();
+	const SearchStats& search_stats();
+	Move suggested_move() override;
 
-	std::string search_eval();
-	std::string search_PV();
-	bool search_ongoing();
-	int search_depth();
-	double search_duration();
-	int search_speed();
-	Move suggested_move();
+	int evaluate();
+	int piece_activity(Piece* p);
+	void clear_eval_cache();
+	bool is_mate_eval(int value);
+	std::vector<EvalParam> eval_params();
+
+	static u_long tt_size(u_long alloc);
 
-	void soft_close();
-	void close();
+	void soft_close() override;
+	void close() override;
 
 private:
+	friend class Bench; // times private hot paths
 
 	void tt_store(u_short depth, Flag_TT flag, int value, Move move);
-	int tt_lookup(u_short depth, int alpha, int beta);
+	int tt_lookup(u_short depth, int alpha, int beta, Move* hashMove);
+	Key* tt_key();
+	bool tt_mirrored();
 	TT* tt_current();
-	void tt_print(TT* entry);
+	bool tt_read(TT_Entry* entry);
+	Move tt_move(TT_Entry* entry);
+	void tt_print();
+
+	int eval_cached();
 
 	void gh_store();
 	void gh_remove();
 	bool gh_match();
 	void gh_clear_played();
 
-	void add_legal_moves();
-	void add_move(Move move);
 	void make_move(Move move);
 	void unmake_move(Move move);
 	void traverse_forwards(Line* line, int dist);
 	void traverse_backwards(Line* line, int dist);
 	
 	void search_fixed_depth(int depth);
+	int search_root(int depth, int alpha, int beta, Line* line);
+	void search_multi_pv(int depth);
 	int search_alphabeta(int depth, int alpha, int beta, Line* line);
-	std::clock_t search_clock();
+	bool search_book();
+	long long search_clock();
 	bool search_exit(bool case_, std::string message);
 
-	void init_eval_boards();
-	int evaluate();
-	bool is_mate_eval(int value);
+	std::string eval_to_string(int value);
 
 	std::string to_string();
 	void print();
 
-	void __CHART_TIME(int index);
-	void __PRINT_CHART();
 	void __DEBUG(bool case_, std::string message);
 
 };
@@ -0,0 +1,240 @@
+// bench.cpp
+
+#include "bench.h"
+#include "analysis.h"
+#include <fstream>
+#include <chrono>
+
+using std::string;
+using std::vector;
+using std::format;
+
+namespace Bbot2 {
+
+// Bench //
+
+// constructor
+Bench::Bench()
+	: game(&board), comp(&game) {}
+
+// get settings from .ini
+// engine is configured by the same .ini, so it must outlive run()
+void Bench::settings(CSimpleIniA* config_) {
+	config = config_;
+
+	board.DEFAULT_START_POS = string(config->GetValue("GAME", "start-pos", board.DEFAULT_START_POS.c_str()));
+}
+
+// read corpus from positions file
+void Bench::load(string filename) {
+	std::ifstream file(filename);
+
+	if (!file)
+		throw Exception("Could not load " + filename);
+
+	string line, squares;
+	vector<AnalysisJob> jobs;
+
+	while (std::getline(file, line))
+		if (!line.empty() && line[0] != '#' && !Analysis::parse_positions(line, &squares, &jobs))
+			throw Exception("Invalid position in " + filename);
+
+	for (AnalysisJob& job : jobs)
+		positions.push_back(job.position);
+
+	if (positions.empty())
+		throw Exception("No positions found in " + filename);
+}
+
+// generate corpus of positions after random legal moves from the start position
+// seeded, so runs with the same settings measure the same positions
+void Bench::random_positions() {
+	Board b;
+	b.DEFAULT_START_POS = board.DEFAULT_START_POS;
+	b.init();
+
+	std::mt19937 rng(SEED);
+	Move move;
+
+	for (int i = 0; i < NUM_RANDOM_POSITIONS; i ++) {
+		b.reset();
+
+		int plies = rng() % (MAX_RANDOM_PLIES + 1);
+
+		for (int ply = 0; ply < plies; ply ++) {
+			if (!b.random_move(rng, &move))
+				break;
+
+			b.move_piece(b.pointerBoard[move.get_from()], move.get_to());
+			b.update_move_sets();
+
+			// stop before position is won
+			if ((b.occupancyBySide[!b.sideToMove] & b.wateringHoles).count() >= NUM_WH_TO_WIN - 1)
+				break;
+		}
+
+		positions.push_back(b.to_compact());
+	}
+
+	b.close();
+}
+
+////
+
+// run all benchmarks over corpus
+void Bench::run() {
+	if (positions.empty())
+		random_positions();
+
+	board.init();
+	game.init();
+
+	comp.settings(config);
+	comp.init();
+
+	// TT benchmarks count into search stats, as during a search
+	comp.stats.depths.assign(1, DepthStats());
+	comp.iteration = &comp.stats.depths[0];
+
+	__PRINT(format("Benchmarking {} positions, {} samples of {} repeats\n", positions.size(), SAMPLES, REPEATS));
+
+	measure("Board::update_piece_sight", [this]() {
+		for (Side side : SIDES)
+			for (Piece* p : board.pieces[side])
+				board.update_piece_sight(p);
+
+		return NUM_PIECES;
+	});
+
+	measure("Board::quick_move_sets", [this]() {
+		board.quick_move_sets();
+		return 1;
+	});
+
+	measure("Board::update_move_sets", [this]() {
+		board.update_move_sets();
+		return 1;
+	});
+
+	// one operation is a move and its unmove
+	measure("Board::move_piece (make/unmake)", [this]() {
+		for (Move m : moves) {
+			Piece* p = board.pointerBoard[m.get_from()];
+
+			board.move_piece(p, m.get_to());
+			board.move_piece(p, m.get_from());
+		}
+
+		return (int) moves.size();
+	});
+
+	measure("Bbot::evaluate", [this]() {
+		sink = sink + comp.evaluate();
+		return 1;
+	});
+
+	measure("Bbot::tt_store", [this]() {
+		comp.tt_store(1, FLAG_EXACT, 0, moves.empty() ? Move() : moves[0]);
+		return 1;
+	});
+
+	measure("Bbot::tt_lookup", [this]() {
+		Move hashMove;
+		sink = sink + comp.tt_lookup(1, -INT_MAX, INT_MAX, &hashMove);
+		return 1;
+	});
+
+	// one operation is a bit found
+	measure("Bitboard::scan_forward", [this]() {
+		bboard b = board.occupancy;
+		u_long scalar;
+		int n = 0;
+
+		while (Bitboard::scan_forward(&scalar, &b)) {
+			b ^= Bitboard::SQUARES[scalar];
+			sink = sink + scalar;
+			n ++;
+		}
+
+		return n;
+	});
+
+	comp.release_game();
+	comp.close();
+	game.close();
+	board.close();
+}
+
+// print results
+void Bench::print() {
+	__PRINT(format("\n{:<34} {:>10} {:>10} {:>10} {:>12}\n", "BENCHMARK", "ns/op", "stddev", "min", "ops/sample"));
+
+	for (BenchResult& r : results)
+		__PRINT(format("{:<34} {:>10.2f} {:>10.2f} {:>10.2f} {:>12}\n", r.name, r.mean, r.stddev, r.min, r.ops));
+}
+
+////
+
+// set up position, untimed
+void Bench::set_up(const string& position) {
+	comp.release_game();
+	game.close();
+
+	board.from_compact(position);
+
+	game.init();
+	comp.attach_game(&game);
+
+	// legal moves
+	moves.clear();
+
+	for (Piece* p : board.pieces[board.sideToMove]) {
+		bboard moveBoard = p->moveBoard;
+		u_long scalar;
+
+		while (Bitboard::scan_forward(&scalar, &moveBoard)) {
+			moveBoard ^= Bitboard::SQUARES[scalar];
+			moves.push_back(Move(p->scalar, (u_short) scalar));
+		}
+	}
+}
+
+// time op over every position, once per sample
+// op returns the number of operations it made
+template <typename Op>
+void Bench::measure(string name, Op op) {
+	vector<double> samples;
+	unsigned __int64 ops = 0;
+
+	for (int s = 0; s < SAMPLES; s ++) {
+		double ns = 0;
+		ops = 0;
+
+		for (const string& position : positions) {
+			set_up(position);
+
+			auto start = std::chrono::steady_clock::now();
+
+			for (int r = 0; r < REPEATS; r ++)
+				ops += op();
+
+			ns += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+		}
+
+		samples.push_back(ops > 0 ? ns / ops : 0);
+	}
+
+	double mean = 0, var = 0;
+
+	for (double x : samples)
+		mean += x / samples.size();
+
+	for (double x : samples)
+		var += (x - mean) * (x - mean) / samples.size();
+
+	results.push_back({ name, mean, std::sqrt(var), *std::min_element(samples.begin(), samples.end()), ops });
+
+	__PRINT(format("   {}: {:.2f} ns/op\n", name, mean));
+}
+
+} // end namespace Bbot2
@@ -0,0 +1,79 @@
+// bench.h
+
+// microbenchmarks of the board and engine hot paths, so each can be measured in isolation:
+// piece sight, quick and full move set updates, make/unmake pairs, static eval, TT lookup and store, and bitboard scans
+
+// every benchmark runs over a corpus of positions, from a positions file (see analysis.h) or from seeded random games
+// each position is set up untimed, then its operation is timed REPEATS times in a row
+// one pass over the corpus is a sample. results are the mean ns per operation over SAMPLES samples, with their spread
+
+#pragma once
+
+#include "common.h"
+#include "log.h"
+#include "board.h"
+#include "game.h"
+#include "bbot.h"
+#include <random>
+
+namespace Bbot2 {
+
+// result of a benchmark
+typedef struct BenchResult {
+	std::string name;
+	double mean; // ns per operation
+	double stddev; // between samples
+	double min;
+	unsigned __int64 ops; // per sample
+} BenchResult;
+
+class Bench {
+public:
+	////
+
+	//// SETTINGS ////
+
+	int SAMPLES = 10;
+	int REPEATS = 32; // timed calls per position, so the clock is read rarely
+
+	// random corpus, used if no positions file is given
+	int NUM_RANDOM_POSITIONS = 1000;
+	int MAX_RANDOM_PLIES = 60; // positions are taken after 0 to MAX_RANDOM_PLIES random moves from the start position
+	unsigned int SEED = 0xBE9C4;
+
+	////
+
+private:
+	CSimpleIniA* config = nullptr; // engine settings
+
+	std::vector<std::string> positions; // compact notation
+	std::vector<BenchResult> results;
+
+	std::vector<Move> moves; // legal moves of current position
+
+	// one set of objects, set up for every position
+	Board board;
+	Game game;
+	Bbot comp;
+
+	volatile unsigned __int64 sink = 0; // results of benchmarked calls, so they are not optimized away
+
+public:
+	Bench();
+
+	void settings(CSimpleIniA* config_);
+
+	void load(std::string filename);
+	void random_positions();
+
+	void run();
+	void print();
+
+private:
+	void set_up(const std::string& position);
+
+	template <typename Op>
+	void measure(std::string name, Op op);
+};
+
+} // end namespace Bbot2
@@ -10,8 +10,14 @@ namespace Bbot2 {
 
 namespace Bitboard {
 
-// initialize values
+// initialize values, once per process
+// safe to call from several threads
 void init() {
+	std::call_once(initialized, generate);
+}
+
+// generate values
+void generate() {
 
 	// first row
 	ROW_1 = from_ullong(0, (unsigned __int64) pow(2, BOARD_SIZE) - 1);
@@ -74,28 +80,9 @@ bboard square(int n) {
 	return b;
 }
 
-// random bitboard
-bboard random() {
-	int w = 15;
-	
-	// RAND_MAX is typically 15-bits long (0x7FFF)
-	// if not, calculate MSB
-
-	if (RAND_MAX != (1 << w) - 1) {
-		int r = RAND_MAX;
-		w = 1;
-		while (r >>= 1) w ++;
-	}
-
-	bboard b(rand());
-
-	// add rand(), shift, and repeat
-	for (int i = w; i < NUM_SQUARES; i += w) {
-		b <<= w;
-		b |= rand();
-	}
-
-	return b;
+// random bitboard from rng
+bboard random(std::mt19937_64& rng) {
+	return from_ullong(rng(), rng());
 }
 
 ////
@@ -132,6 +119,34 @@ bool scan_reverse(u_long* result, bboard* b) {
 	return false;
 }
 
+// compare as unsigned 128-bit integers
+// returns true if a < b
+bool less_than(bboard* a, bboard* b) {
+	unsigned __int64* n = reinterpret_cast<unsigned __int64*>(a);
+	unsigned __int64* m = reinterpret_cast<unsigned __int64*>(b);
+
+	// most significant 64 bits decide, unless equal
+	if (*(n + 1) != *(m + 1))
+		return *(n + 1) < *(m + 1);
+
+	return *n < *m;
+}
+
+// bits 0-63 of bboard
+unsigned __int64 lower_word(bboard* p) {
+	return *reinterpret_cast<unsigned __int64*>(p);
+}
+
+// bits 64-99 of bboard, as read by less_than
+unsigned __int64 upper_word(bboard* p) {
+	return *(reinterpret_cast<unsigned __int64*>(p) + 1);
+}
+
+// scalar mirrored across center files (a <-> j, b <-> i, ...)
+int mirror_scalar(int k) {
+	return k - 2 * (k % BOARD_SIZE) + BOARD_SIZE - 1;
+}
+
 // any occupancy in a file will put a 1 in its intersection with the first row
 // all other rows masked out
 void collapse_to_row(bboard* b) {
@@ -29,6 +29,8 @@
 #include <cstdlib>
 #include <string>
 #include <functional>
+#include <mutex>
+#include <random>
 
 namespace Bbot2 {
 
@@ -36,16 +38,23 @@ namespace Bitboard {
 	inline bboard ROW_1;
 	inline bboard FILE_A;
 	inline bboard SQUARES[NUM_SQUARES];
+	inline std::once_flag initialized;
 
 	void init();
+	void generate();
 
 	bboard from_ullong(unsigned __int64 v1, unsigned __int64 v2);
 	bboard from_string(std::string s);
 	bboard square(int n);
-	bboard random();
+	bboard random(std::mt19937_64& rng);
 
 	bool scan_forward(u_long* result, bboard* p);
 	bool scan_reverse(u_long* result, bboard* p);
+	bool less_than(bboard* a, bboard* b);
+	unsigned __int64 lower_word(bboard* p);
+	unsigned __int64 upper_word(bboard* p);
+
+	int mirror_scalar(int k);
 
 	void collapse_to_row(bboard* p);
 	void collapse_to_file(bboard* p);
@@ -1,6 +1,7 @@
 // board.cpp
 
 #include "board.h"
+#include <charconv>
 
 using std::string;
 using std::vector;
@@ -24,51 +25,266 @@ void Board::from_string(string s) {
 
 	int k, len = 0;
 
-	// iterate through string, find matching char from BOARD_CHARS, and create Piece
-	// BOARD_CHARS = "MLEmle."
+	// iterate through string, find herd of each char from BOARD_CHARS, and create Piece
 	for (char c : s) {
-		for (int herd = 0; herd < NUM_HERDS + 1; herd ++) {
-			if (c == BOARD_CHARS[herd]) {
-				if (herd >= NUM_HERDS) {
-					len ++;
-					break;
-				}
-
-				k = len % BOARD_SIZE + (BOARD_SIZE - 1 - len / BOARD_SIZE) * BOARD_SIZE;
-				add_piece(herd, k);
-				len ++;
-			}
+		int herd = herd_of(c);
+
+		if (herd < 0)
+			continue;
+
+		if (herd < NUM_HERDS) {
+			k = len % BOARD_SIZE + (BOARD_SIZE - 1 - len / BOARD_SIZE) * BOARD_SIZE;
+			add_piece(herd, k);
 		}
 
-		if (len >= NUM_SQUARES)
+		if (++ len >= NUM_SQUARES)
 			break;
 	}
 
 	// full initialization expected afterwards
 }
 
+// set up position from compact notation, see board.h
+// ply is optional. unlike from_string, board is fully initialized afterwards
+void Board::from_compact(std::string_view s) {
+	int herds[NUM_SQUARES];
+	Side side;
+	int ply_;
+
+	if (!parse_compact(s, herds, &side, &ply_))
+		throw Exception("Invalid position: " + string(s));
+
+	set_position(herds, side, ply_);
+}
+
+// set up position from packed form, with given side to move
+// board is fully initialized afterwards
+void Board::unpack(const PackedBoard& packed, Side side) {
+	int herds[NUM_SQUARES];
+	std::fill(herds, herds + NUM_SQUARES, -1);
+
+	for (int i = 0; i < NUM_PIECES; i ++) {
+		// two pieces on a square would silently drop one
+		if (packed.squares[i] >= NUM_SQUARES || herds[packed.squares[i]] >= 0)
+			throw Exception("Invalid packed position");
+
+		herds[packed.squares[i]] = i / PIECES_PER_HERD;
+	}
+
+	set_position(herds, side, 0);
+}
+
+// write current position in compact notation to buffer, null-terminated
+// returns length written
+size_t Board::to_compact(char buffer[COMPACT_MAX_LEN]) {
+	int herds[NUM_SQUARES];
+
+	for (int i = 0; i < NUM_SQUARES; i ++)
+		herds[i] = pointerBoard[i] == nullptr ? -1 : pointerBoard[i]->herd;
+
+	return write_compact(herds, SIDES[sideToMove], ply, buffer);
+}
+
+// current position in compact notation
+string Board::to_compact() {
+	char buffer[COMPACT_MAX_LEN];
+	size_t len = to_compact(buffer);
+
+	return string(buffer, len);
+}
+
+// current position in packed form
+PackedBoard Board::pack() {
+	PackedBoard packed;
+	int count[NUM_HERDS] = { 0 };
+
+	for (Side side : SIDES) {
+		for (Piece* p : pieces[side]) {
+			if (count[p->herd] >= PIECES_PER_HERD)
+				throw Exception("Packed positions require " + std::to_string(PIECES_PER_HERD) + " pieces per herd");
+
+			packed.squares[p->herd * PIECES_PER_HERD + count[p->herd] ++] = (u_byte) p->scalar;
+		}
+	}
+
+	for (int herd = 0; herd < NUM_HERDS; herd ++) {
+		if (count[herd] != PIECES_PER_HERD)
+			throw Exception("Packed positions require " + std::to_string(PIECES_PER_HERD) + " pieces per herd");
+
+		std::sort(&packed.squares[herd * PIECES_PER_HERD], &packed.squares[(herd + 1) * PIECES_PER_HERD]);
+	}
+
+	return packed;
+}
+
+////
+
+// read compact notation into herd of each square (-1 if empty), side to move, and ply (0 if not given)
+// returns false if s is not valid, if a herd has more than PIECES_PER_HERD pieces, or if a side has none
+// every char of a rank fills its own square, so two pieces never share one. does not allocate
+bool Board::parse_compact(std::string_view s, int herds[NUM_SQUARES], Side* side, int* ply_) {
+	std::fill(herds, herds + NUM_SQUARES, -1);
+
+	size_t i = 0;
+	int row = BOARD_SIZE - 1;
+	int col = 0;
+	int herdCount[NUM_HERDS] = {};
+
+	// ranks
+	for (; i < s.size() && s[i] != ' '; i ++) {
+		char c = s[i];
+
+		if (c == '/') {
+			if (col != BOARD_SIZE || row == 0)
+				return false;
+
+			row --;
+			col = 0;
+		} else if (c >= '1' && c <= '9') {
+			int n = c - '0';
+
+			// "10" is a full empty rank
+			if (n == 1 && i + 1 < s.size() && s[i + 1] == '0') {
+				n = BOARD_SIZE;
+				i ++;
+			}
+
+			if (col + n > BOARD_SIZE)
+				return false;
+
+			col += n;
+		} else {
+			int herd = herd_of(c);
+
+			if (herd < 0 || herd >= NUM_HERDS || col >= BOARD_SIZE)
+				return false;
+
+			// engine buffers are sized for PIECES_PER_HERD pieces of a herd, see movepicker.h and nnue.h
+			if (++ herdCount[herd] > PIECES_PER_HERD)
+				return false;
+
+			herds[row * BOARD_SIZE + col ++] = herd;
+		}
+	}
+
+	if (row != 0 || col != BOARD_SIZE)
+		return false;
+
+	// both sides must have pieces, see init
+	int white = 0, black = 0;
+	for (int herd = 0; herd < NUM_HERDS; herd ++)
+		(herd < NUM_TYPES ? white : black) += herdCount[herd];
+
+	if (white == 0 || black == 0)
+		return false;
+
+	// side to move
+	while (i < s.size() && s[i] == ' ')
+		i ++;
+
+	if (i >= s.size() || (s[i] != 'w' && s[i] != 'b'))
+		return false;
+
+	*side = s[i ++] == 'b' ? BLACK : WHITE;
+
+	// ply
+	while (i < s.size() && s[i] == ' ')
+		i ++;
+
+	*ply_ = 0;
+	while (i < s.size() && s[i] >= '0' && s[i] <= '9')
+		*ply_ = *ply_ * 10 + (s[i ++] - '0');
+
+	while (i < s.size() && s[i] == ' ')
+		i ++;
+
+	return i == s.size();
+}
+
+// write compact notation of herd on each square (-1 if empty), side to move, and ply to buffer, null-terminated
+// returns length written. does not allocate
+size_t Board::write_compact(const int herds[NUM_SQUARES], Side side, int ply_, char buffer[COMPACT_MAX_LEN]) {
+	char* c = buffer;
+	char* end = buffer + COMPACT_MAX_LEN - 1;
+
+	for (int row = BOARD_SIZE - 1; row >= 0; row --) {
+		int empty = 0;
+
+		for (int col = 0; col < BOARD_SIZE; col ++) {
+			int herd = herds[row * BOARD_SIZE + col];
+
+			if (herd < 0) {
+				empty ++;
+				continue;
+			}
+
+			if (empty > 0)
+				c = std::to_chars(c, end, empty).ptr;
+
+			*c ++ = BOARD_CHARS[herd];
+			empty = 0;
+		}
+
+		if (empty > 0)
+			c = std::to_chars(c, end, empty).ptr;
+
+		if (row > 0)
+			*c ++ = '/';
+	}
+
+	*c ++ = ' ';
+	*c ++ = side ? 'b' : 'w';
+	*c ++ = ' ';
+	c = std::to_chars(c, end, ply_).ptr;
+	*c = '\0';
+
+	return c - buffer;
+}
+
+// herd of a char of BOARD_CHARS ("MLEmle."), NUM_HERDS for an empty square, or -1 if not a board char
+int Board::herd_of(char c) {
+	switch (c) {
+		case 'M': return 0;
+		case 'L': return 1;
+		case 'E': return 2;
+		case 'm': return 3;
+		case 'l': return 4;
+		case 'e': return 5;
+		case '.': return NUM_HERDS;
+		default: return -1;
+	}
+}
+
 ////
 
 // get settings from .ini
-void Board::settings() {
-	DEFAULT_START_POS = string(ini.GetValue("GAME", "start-pos"));
+void Board::settings(CSimpleIniA* config) {
+	DEFAULT_START_POS = string(config->GetValue("GAME", "start-pos", DEFAULT_START_POS.c_str()));
 }
 
 // init
 void Board::init() {
-	if (!Tables::initialized)
-		Tables::init();
+	// generate tables, if not already generated
+	Tables::init();
 
 	// set up starting position, if not already set up
 	if (pieces[WHITE].empty() || pieces[BLACK].empty())
 		from_string(DEFAULT_START_POS);
 
+	// white to move, before move sets are generated
+	// a board reset after a game may still have black to move
+	sideToMove = 0;
+
 	// set up watering holes
 	init_WH();
 
 	// set up pieces, their relationships, and threats 
 	init_pieces();
 
+	// accumulator of new position, as init_pieces moved pieces through incomplete positions
+	if (network)
+		network->refresh(&accumulator, this);
+
 	// init zobrist key/values
 	init_zobrist_values();
 
@@ -78,7 +294,7 @@ void Board::init() {
 	// get startPointerBoard from pointerBoard
 	std::copy(pointerBoard, &pointerBoard[NUM_SQUARES], startPointerBoard);
 
-	sideToMove = 0; // white
+	initialized = true;
 }
 
 // reset
@@ -88,6 +304,21 @@ void Board::reset() {
 	init();
 }
 
+// set side to move of an initialized position, e.g. one set up by from_string with black to move
+// keys are updated so the position matches the same position reached by play
+void Board::set_side(Side side) {
+	if (sideToMove != side) {
+		sideToMove = side;
+
+		key ^= CHANGE_SIDE;
+		mirrorKey ^= CHANGE_SIDE;
+		hash = key_to_hash(key);
+		update_tt_key();
+	}
+
+	update_move_sets();
+}
+
 ////
 
 // update move set bboards
@@ -138,12 +369,89 @@ void Board::quick_move_sets() {
 	}
 }
 
+// recount safe squares of pieces whose sight or scaredByMap changed since they were last counted
+// sight is updated first where scheduled, without updating move sets, as evaluation at leaves does not generate them
+void Board::update_safe_squares() {
+	for (Side side : SIDES) {
+		for (Piece* p : pieces[side]) {
+			if (p->schedSightUpdate) {
+				update_piece_sight(p);
+				p->schedSightUpdate = false;
+			}
+
+			if (p->schedSafeUpdate) {
+				bboard safe = p->sightBoard & ~*(p->scaredByMap);
+				p->safeSquares = (int) safe.count();
+				p->safeWH = (int) (safe & wateringHoles).count();
+				p->schedSafeUpdate = false;
+			}
+		}
+	}
+}
+
+// check if a move is legal without generating the full move set
+// only the moving piece and any threatened pieces of its side are updated
+bool Board::quick_is_legal(Move move) {
+	Piece* p = pointerBoard[move.get_from()];
+
+	// must be a piece of the side to move
+	if (p == nullptr || p->side != SIDES[sideToMove])
+		return false;
+
+	update_piece_moves(p);
+
+	if (!p->moveBoard[move.get_to()])
+		return false;
+
+	// if piece is not forced, no other piece can be forced
+	return p->isForced || !other_piece_forced(p);
+}
+
+// find a move that wins immediately for the side to move
+// i.e., a move onto the last watering hole needed while holding all others
+bool Board::find_winning_move(Move* result) {
+	return find_wh_move(SIDES[sideToMove], result, true);
+}
+
+// check if side holds all watering holes needed to win but one, and can reach the last
+// when side is not to move, forced pieces are not considered since they depend on the move in between
+bool Board::threatens_win(Side side) {
+	Move move;
+	return find_wh_move(side, &move, side == SIDES[sideToMove]);
+}
+
+// uniformly random legal move for side to move
+// returns false if side has no legal move
+bool Board::random_move(std::mt19937& rng, Move* result) {
+	vector<Move> moves;
+
+	for (Piece* p : pieces[sideToMove]) {
+		bboard moveBoard = p->moveBoard;
+		u_long scalar;
+
+		while (Bitboard::scan_forward(&scalar, &moveBoard)) {
+			moveBoard ^= Bitboard::SQUARES[scalar];
+			moves.push_back(Move(p->scalar, (u_short) scalar));
+		}
+	}
+
+	if (moves.empty())
+		return false;
+
+	*result = moves[rng() % moves.size()];
+	return true;
+}
+
 ////
 
 // move piece on board and update
 void Board::move_piece(Piece* p, u_short dest) {
 	//__DEBUG(p == nullptr, "Could not get piece data.");
 
+	// threats before move, for accumulator
+	u_short from = p->scalar;
+	u_long wasThreatened = network ? threat_flags(p) : 0;
+
 	// remove from pointer board
 	pointerBoard[p->scalar] = nullptr;
 
@@ -171,9 +479,22 @@ void Board::move_piece(Piece* p, u_short dest) {
 	// update threats
 	update_threats(p);
 
+	// update accumulator
+	if (network)
+		update_accumulator(p, from, wasThreatened);
+
 	sideToMove = !sideToMove; // flip side
 }
 
+// attach network to be kept up to date by move_piece, or detach it with nullptr
+// network must outlive board, or be detached first
+void Board::attach_network(const Nnue* network_) {
+	network = network_;
+
+	if (network)
+		network->refresh(&accumulator, this);
+}
+
 ////
 
 // close
@@ -282,11 +603,67 @@ void Board::init_WH() {
 	wateringHoles = Bitboard::from_string(WATERING_HOLES_STR);
 
 	// get scalar values from watering holes
+	whScalars.clear();
 	for (int i = 0; i < NUM_SQUARES; i ++)
 		if (wateringHoles[i])
 			whScalars.push_back(i);
 }
 
+// set up position from herd of each square (-1 if empty), then initialize
+// if every herd keeps its number of pieces, existing pieces are moved instead of reallocated
+void Board::set_position(const int herds[NUM_SQUARES], Side side, int ply_) {
+	int count[NUM_HERDS] = { 0 };
+
+	for (int k = 0; k < NUM_SQUARES; k ++)
+		if (herds[k] >= 0)
+			count[herds[k]] ++;
+
+	// pieces are only valid while initialized, see close
+	bool reuse = initialized;
+
+	if (reuse)
+		for (Side s : SIDES)
+			for (Piece* p : pieces[s])
+				count[p->herd] --;
+
+	for (int herd = 0; herd < NUM_HERDS; herd ++)
+		reuse = reuse && count[herd] == 0;
+
+	if (reuse) {
+		// next square of each herd to place a piece on
+		int next[NUM_HERDS] = { 0 };
+
+		for (Side s : SIDES) {
+			for (Piece* p : pieces[s]) {
+				int& k = next[p->herd];
+
+				while (herds[k] != p->herd)
+					k ++;
+
+				p->move(k ++);
+				p->schedSightUpdate = true;
+				p->isThreatened = false;
+				p->isForced = false;
+				p->moveBoard = bboard(0);
+			}
+		}
+	} else {
+		if (initialized)
+			close();
+
+		pieces[WHITE].clear();
+		pieces[BLACK].clear();
+
+		for (int k = 0; k < NUM_SQUARES; k ++)
+			if (herds[k] >= 0)
+				add_piece(herds[k], k);
+	}
+
+	init();
+	set_side(side);
+	ply = ply_;
+}
+
 // initialize pieces, pointerBoard, and threatMaps
 void Board::init_pieces() {
 	// clear pointer board
@@ -364,6 +741,7 @@ void Board::update_piece_sight(Piece* p) {
 	// get position of piece as int 0 -> NUM_SQUARES - 1
 	int k = p->scalar;
 	p->sightBoard.reset();
+	p->schedSafeUpdate = true;
 
 	// mouse or elephant
 	if (p->movesLikeRook) {
@@ -441,6 +819,60 @@ void Board::update_piece_moves(Piece* p) {
 	}
 }
 
+// true if any piece of p's side other than p is forced
+// only threatened pieces can be forced, so only those are updated
+bool Board::other_piece_forced(Piece* p) {
+	for (Piece* q : pieces[p->side]) {
+		if (q == p || !q->isThreatened)
+			continue;
+
+		update_piece_moves(q);
+
+		if (q->isForced)
+			return true;
+	}
+
+	return false;
+}
+
+// find a move by side onto a free watering hole, if side already holds NUM_WH_TO_WIN - 1
+// pieces are ruled out with the empty board sight table before any sight is updated
+// checkForced: only allow moves legal under forced-move rules
+bool Board::find_wh_move(Side side, Move* result, bool checkForced) {
+	// must need exactly one more watering hole
+	if ((occupancyBySide[side] & wateringHoles).count() < NUM_WH_TO_WIN - 1)
+		return false;
+
+	bboard freeWH = wateringHoles & ~occupancy;
+	bboard reach;
+	u_long scalar;
+
+	for (Piece* p : pieces[side]) {
+
+		// pieces already on a watering hole can't add another
+		if (wateringHoles[p->scalar])
+			continue;
+
+		// free watering hole must be on one of the piece's lines
+		if ((Tables::emptySightTable[p->type][p->scalar] & freeWH).none())
+			continue;
+
+		update_piece_moves(p);
+
+		reach = p->moveBoard & freeWH;
+		if (!Bitboard::scan_forward(&scalar, &reach))
+			continue;
+
+		if (checkForced && !p->isForced && other_piece_forced(p))
+			continue;
+
+		*result = Move(p->scalar, static_cast<u_short>(scalar));
+		return true;
+	}
+
+	return false;
+}
+
 ////
 
 // remove from occupancy maps
@@ -469,8 +901,63 @@ void Board::update_threats(Piece* p) {
 	p->update_threatened();
 
 	// check whether pieces scared by p are threatened
-	for (Piece* q : p->scares)
+	// their safe squares change with the threat map
+	for (Piece* q : p->scares) {
 		q->update_threatened();
+		q->schedSafeUpdate = true;
+	}
+}
+
+// threatened flags of p (bit 0) and the pieces it scares (bit i + 1), the only flags update_threats changes
+u_long Board::threat_flags(Piece* p) {
+	u_long flags = p->isThreatened;
+
+	for (size_t i = 0; i < p->scares.size() && i < NNUE_MAX_SCARED; i ++)
+		flags |= (u_long) p->scares[i]->isThreatened << (i + 1);
+
+	return flags;
+}
+
+// add and subtract features changed by moving p, see Nnue
+// wasThreatened: threat_flags before move
+void Board::update_accumulator(Piece* p, u_short from, u_long wasThreatened) {
+	// more pieces than threat_flags holds, only possible in a set up position
+	if (p->scares.size() > NNUE_MAX_SCARED) {
+		network->refresh(&accumulator, this);
+		return;
+	}
+
+	int added[NNUE_MAX_ACTIVE], removed[NNUE_MAX_ACTIVE];
+	int numAdded = 0, numRemoved = 0;
+
+	bool moved = from != p->scalar;
+	bool was = wasThreatened & 1;
+
+	if (moved) {
+		removed[numRemoved ++] = Nnue::piece_feature(p->herd, from);
+		added[numAdded ++] = Nnue::piece_feature(p->herd, p->scalar);
+	}
+
+	if (was && (moved || !p->isThreatened))
+		removed[numRemoved ++] = Nnue::threat_feature(p->herd, from);
+
+	if (p->isThreatened && (moved || !was))
+		added[numAdded ++] = Nnue::threat_feature(p->herd, p->scalar);
+
+	for (size_t i = 0; i < p->scares.size(); i ++) {
+		Piece* q = p->scares[i];
+
+		if (q->isThreatened == (bool) (wasThreatened >> (i + 1) & 1))
+			continue;
+
+		if (q->isThreatened)
+			added[numAdded ++] = Nnue::threat_feature(q->herd, q->scalar);
+		else
+			removed[numRemoved ++] = Nnue::threat_feature(q->herd, q->scalar);
+	}
+
+	if (numAdded + numRemoved > 0)
+		network->update(&accumulator, added, numAdded, removed, numRemoved);
 }
 
 ////
@@ -478,18 +965,22 @@ void Board::update_threats(Piece* p) {
 // initialize all values/tables used for zobrist key
 void Board::init_zobrist_values() {
 
-	CHANGE_SIDE = Bitboard::random();
+	CHANGE_SIDE = Tables::zobristSide;
 	key = Key(0);
+	mirrorKey = Key(0);
 	hash = 0;
 
 	// init zobrist 
-	for (Side side : SIDES)
-		for (Piece* p : pieces[side])
+	for (Side side : SIDES) {
+		for (Piece* p : pieces[side]) {
 			key ^= Tables::zobristTable[p->herd][p->scalar];
+			mirrorKey ^= Tables::zobristMirror[p->herd][p->scalar];
+		}
+	}
 
 	// set up hash
-	KEY_MASK = Key(TT_ALLOC - 1);
 	hash = key_to_hash(key);
+	update_tt_key();
 }
 
 // update zobrist key
@@ -503,13 +994,28 @@ void Board::update_zobrist_key(Piece* p, u_short dest) {
 	// add to key
 	key ^= Tables::zobristTable[p->herd][dest];
 
+	// same for mirrored key
+	mirrorKey ^= Tables::zobristMirror[p->herd][p->scalar];
+	mirrorKey ^= Tables::zobristMirror[p->herd][dest];
+
 	// next side to play
 	key ^= CHANGE_SIDE;
+	mirrorKey ^= CHANGE_SIDE;
 
-	// masked key reduction for tt index
+	// reduced key for game history index
 	hash = key_to_hash(key);
+
+	update_tt_key();
+}
+
+// choose smaller of key and mirrorKey for tt
+void Board::update_tt_key() {
+	mirrored = Bitboard::less_than(&mirrorKey, &key);
+	ttKey = mirrored ? mirrorKey : key;
+	ttHash = key_to_hash(ttKey);
 }
 
+// lower bits of key, reduced further by each Bbot to the size of its TT
 u_long Board::key_to_hash(Key key_) {
 	return (KEY_MASK & key_).to_ulong();
 }
@@ -12,10 +12,20 @@
 #include "line.h"
 #include "tables.h"
 #include "bitboard.h"
+#include "nnue.h"
+#include <random>
 
 
 namespace Bbot2 {
 
+// position packed into one byte per piece, its scalar, in herd order and ascending within each herd
+// only for positions with PIECES_PER_HERD pieces in every herd. side to move is not included
+typedef struct PackedBoard {
+	u_byte squares[NUM_PIECES];
+} PackedBoard;
+
+static_assert(sizeof(PackedBoard) == NUM_PIECES, "PackedBoard must be packed");
+
 class Board {
 public:
 	// Starting position
@@ -60,9 +70,16 @@ public:
 	Piece* startPointerBoard[NUM_SQUARES];; // starting position of pointerBoard - remains unchanged
 
 	Key CHANGE_SIDE;
-	Key key; // full zobrist key used for tt hash
-	u_long hash; // reduced key for tt index
-	Key KEY_MASK; // masks key to size usable for transpositionTable
+	Key key; // full zobrist key
+	u_long hash; // reduced key for game history index
+	const Key KEY_MASK = Key(0xFFFFFFFF); // masks key to the bits of a hash, see key_to_hash
+
+	// the board is symmetric across its center files, so a position and its mirror have the same value
+	// both share a TT entry under the smaller of their two keys
+	Key mirrorKey; // zobrist key of position mirrored across center files
+	Key ttKey; // smaller of key and mirrorKey, used for tt
+	u_long ttHash; // reduced ttKey for tt index
+	bool mirrored = false; // true if ttKey is mirrorKey. moves stored in tt are then mirrored
 
 	bool isSideForced = false; // true when one or more piece of current side is threatened and it has a legal move - this move is then forced
 	int ply = 0; // moves played in game so far, in plies
@@ -71,21 +88,50 @@ public:
 	bboard occupancy; // occupancy of all pieces
 	bboard occupancyBySide[NUM_SIDES]; // occupancy of white [0] and black [1]
 
+	// neural network evaluation, see nnue.h
+	// while a network is attached, move_piece keeps the accumulator up to date
+	const Nnue* network = nullptr;
+	NnueAccumulator accumulator;
+
 private:
 	bboard threatMaps[NUM_HERDS]; // union of adjacent squares for each herd
 
 public:
+	// compact notation, one line with side to move and ply, e.g. the default start position:
+	// "4ee4/3lmml3/10/10/10/10/10/10/3LMML3/4EE4 w 0"
+	// ranks from 10 to 1 separated by '/', pieces as in BOARD_CHARS, digits count empty squares
+	static const int COMPACT_MAX_LEN = 128; // including terminating null
+
 	void from_string(std::string s);
+	void from_compact(std::string_view s);
+	void unpack(const PackedBoard& packed, Side side);
 
-	void settings();
+	size_t to_compact(char buffer[COMPACT_MAX_LEN]);
+	std::string to_compact();
+	PackedBoard pack();
+
+	static bool parse_compact(std::string_view s, int herds[NUM_SQUARES], Side* side, int* ply_);
+	static size_t write_compact(const int herds[NUM_SQUARES], Side side, int ply_, char buffer[COMPACT_MAX_LEN]);
+	static int herd_of(char c);
+
+	void settings(CSimpleIniA* config);
 	void init();
 	void reset();
+	void set_side(Side side);
 
 	void update_move_sets();
 	void quick_move_sets();
+	void update_safe_squares();
+	bool quick_is_legal(Move move);
+
+	bool find_winning_move(Move* result);
+	bool threatens_win(Side side);
+	bool random_move(std::mt19937& rng, Move* result);
 
 	void move_piece(Piece* p, u_short dest);
 
+	void attach_network(const Nnue* network_);
+
 	u_long key_to_hash(Key key_);
 
 	void close();
@@ -99,20 +145,28 @@ public:
 	void __DEBUG(bool condition, std::string message);
 
 private:
+	friend class Bench; // times private hot paths
+
 	void add_piece(int herd, int k);
+	void set_position(const int herds[NUM_SQUARES], Side side, int ply_);
 	void init_WH();
 	void init_pieces();
 
 	void schedule_sight_updates(Piece* p);
 	void update_piece_sight(Piece* p);
 	void update_piece_moves(Piece* p);
+	bool other_piece_forced(Piece* p);
+	bool find_wh_move(Side side, Move* result, bool checkForced);
 
 	void remove_from_occupancy(Piece* p);
 	void add_to_occupancy(Piece* p);
 	void update_threats(Piece* p);
+	u_long threat_flags(Piece* p);
+	void update_accumulator(Piece* p, u_short from, u_long wasThreatened);
 
 	void init_zobrist_values();
 	void update_zobrist_key(Piece* p, u_short dest);
+	void update_tt_key();
 };
 
 } // end namespace Bbot2
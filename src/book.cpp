@@ -0,0 +1,369 @@
+// book.cpp
+
+#include "book.h"
+#include "game.h"
+#include "bbot.h"
+#include <fstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <set>
+
+using std::string;
+using std::vector;
+using std::format;
+
+namespace Bbot2 {
+
+// position to be searched by book builder
+// stored as a line of moves from the start position
+typedef struct BookJob {
+	vector<Move> line;
+	BookEntry entry;
+} BookJob;
+
+// position to be expanded by book builder
+typedef struct BookNode {
+	vector<Move> line;
+	Side engine; // side the book is being built for
+} BookNode;
+
+// jobs of the current ply, handed out to the worker pool of a build
+// workers and their engines live for the whole build, and wait here between plies
+typedef struct BookQueue {
+	std::mutex lock;
+	std::condition_variable jobsReady; // workers wait for jobs of the next ply, or for closing
+	std::condition_variable plyDone; // builder waits for every job of the ply to be searched
+
+	int maxTime;
+	int maxDepth;
+
+	vector<BookJob>* jobs = nullptr; // only changed by builder between plies, while no job is handed out
+	size_t count = 0; // jobs of current ply
+	size_t next = 0; // next job to hand out
+	size_t remaining = 0; // jobs not yet searched
+	int workers = 0; // running workers
+	bool closing = false;
+} BookQueue;
+
+// Book //
+
+// map book file into memory
+// returns false if file is missing or not a valid book
+bool Book::open(string filename) {
+	close();
+
+	if (!file.open(filename))
+		return false;
+
+	// check header
+	const BookHeader* header = static_cast<const BookHeader*>(file.data());
+	BookHeader expected;
+
+	if (file.size() < sizeof(BookHeader) || memcmp(header->magic, expected.magic, sizeof(expected.magic)) != 0
+		|| file.size() < sizeof(BookHeader) + header->numEntries * sizeof(BookEntry)) {
+		close();
+		return false;
+	}
+
+	entries = reinterpret_cast<const BookEntry*>(static_cast<const char*>(file.data()) + sizeof(BookHeader));
+	numEntries = static_cast<size_t>(header->numEntries);
+
+	return true;
+}
+
+// true if a book is mapped
+bool Book::is_open() {
+	return file.is_open();
+}
+
+// unmap book file
+void Book::close() {
+	file.close();
+
+	entries = nullptr;
+	numEntries = 0;
+}
+
+////
+
+// binary search for current position of board
+// returns true and sets move/eval if found
+bool Book::probe(Board* board, Move* move, int* eval) {
+	if (numEntries == 0)
+		return false;
+
+	unsigned __int64 key = key_of(board);
+	const BookEntry* end = entries + numEntries;
+
+	// first entry with key
+	const BookEntry* e = std::lower_bound(entries, end, key,
+		[](const BookEntry& a, unsigned __int64 k) { return a.key < k; });
+
+	// highest weight of all entries with key
+	const BookEntry* best = nullptr;
+
+	for (; e < end && e->key == key; e ++)
+		if (best == nullptr || e->weight > best->weight)
+			best = e;
+
+	if (best == nullptr)
+		return false;
+
+	Move m;
+	m.value = best->move;
+
+	if (board->mirrored)
+		m = m.mirrored();
+
+	// a 64-bit key may collide, so move is checked before use
+	if (!board->quick_is_legal(m))
+		return false;
+
+	*move = m;
+	*eval = best->eval;
+
+	return true;
+}
+
+// book key of current position
+unsigned __int64 Book::key_of(Board* board) {
+	return (board->ttKey & Key(0xFFFFFFFFFFFFFFFF)).to_ullong();
+}
+
+////////////////////////////////
+
+// replay line from start position on board, then update legal moves
+static void replay(Board* board, vector<Move>& line) {
+	board->reset();
+
+	for (Move m : line)
+		board->move_piece(board->pointerBoard[m.get_from()], m.get_to());
+
+	board->update_move_sets();
+}
+
+// search jobs of each ply until the build closes
+// each thread has its own board, game, and engine, configured once from .ini
+// if a worker fails, its job is left with weight 0 and is not written to the book
+static void book_worker(BookQueue* queue, CSimpleIniA* config) {
+	bool holdingJob = false;
+
+	try {
+
+	Board board;
+	board.settings(config);
+	board.init();
+
+	Game game(&board);
+	game.init();
+
+	// engine is attached only to receive played moves, it is never asked to play by game
+	// it may be rebuilding the book of .ini, so does not use it
+	Bbot comp(&game);
+	comp.settings(config);
+	comp.useBook = false;
+	comp.init();
+	game.add_player(&comp, WHITE);
+
+	while (true) {
+		BookJob* job;
+
+		{
+			std::unique_lock<std::mutex> lock(queue->lock);
+
+			if (holdingJob && -- queue->remaining == 0)
+				queue->plyDone.notify_all();
+
+			holdingJob = false;
+			queue->jobsReady.wait(lock, [queue] { return queue->closing || queue->next < queue->count; });
+
+			if (queue->closing)
+				break;
+
+			job = &(*queue->jobs)[queue->next ++];
+			holdingJob = true;
+		}
+
+		// replay line from start position
+		game.reset();
+		comp.attach_game(&game);
+
+		for (Move m : job->line)
+			game.play_move(m);
+
+		// full search
+		while (comp.search(queue->maxTime, queue->maxDepth));
+
+		Move move = comp.suggested_move();
+
+		job->entry.key = Book::key_of(&board);
+		job->entry.move = (board.mirrored ? move.mirrored() : move).value;
+		job->entry.weight = static_cast<u_short>(comp.search_depth());
+		job->entry.eval = comp.search_value();
+	}
+
+	comp.close();
+	game.close();
+	board.close();
+
+	} catch (Exception e) {
+		e.print();
+	}
+
+	// release job of a failed worker, so the builder is not left waiting on it
+	std::lock_guard<std::mutex> lock(queue->lock);
+
+	queue->workers --;
+
+	if (holdingJob)
+		queue->remaining --;
+
+	queue->plyDone.notify_all();
+}
+
+// build book file by searching every engine-to-move position up to the given number of plies
+// config: start position, and settings of the searching engines
+// maxTime/maxDepth: limits for each search
+void Book::build(string filename, CSimpleIniA* config, int plies, int maxTime, int maxDepth, int numThreads) {
+
+	// board used to expand replies
+	Board board;
+	board.settings(config);
+	board.init();
+
+	// worker pool, kept for every ply
+	vector<BookJob> jobs;
+
+	BookQueue queue;
+	queue.maxTime = maxTime;
+	queue.maxDepth = maxDepth;
+	queue.jobs = &jobs;
+	queue.workers = numThreads;
+
+	vector<std::thread> threads;
+
+	for (int i = 0; i < numThreads; i ++)
+		threads.push_back(std::thread(book_worker, &queue, config));
+
+	vector<BookNode> level = { { {}, WHITE }, { {}, BLACK } };
+	vector<BookEntry> entries;
+	std::set<unsigned __int64> seen[NUM_SIDES]; // book keys of positions already added to a level, for each engine side
+
+	for (int ply = 0; ply < plies && !level.empty(); ply ++) {
+		vector<BookNode> nextLevel;
+		jobs.clear();
+
+		for (BookNode& node : level) {
+			replay(&board, node.line);
+
+			// engine to move, search for book move
+			if (board.sideToMove == node.engine) {
+				jobs.push_back({ node.line, BookEntry() });
+				continue;
+			}
+
+			// opponent to move, expand every legal reply
+			for (Piece* p : board.pieces[board.sideToMove]) {
+				bboard moves = p->moveBoard;
+				u_long scalar;
+
+				while (Bitboard::scan_forward(&scalar, &moves)) {
+					moves ^= Bitboard::SQUARES[scalar];
+
+					BookNode child = { node.line, node.engine };
+					child.line.push_back(Move(p->scalar, static_cast<u_short>(scalar)));
+					nextLevel.push_back(child);
+				}
+			}
+		}
+
+		// search all engine-to-move positions on the pool
+		{
+			std::unique_lock<std::mutex> lock(queue.lock);
+
+			queue.next = 0;
+			queue.count = jobs.size();
+			queue.remaining = jobs.size();
+			queue.jobsReady.notify_all();
+
+			queue.plyDone.wait(lock, [&queue] { return queue.remaining == 0 || queue.workers == 0; });
+		}
+
+		if (queue.remaining > 0)
+			break;
+
+		// record entries, and continue each line with its book move
+		for (BookJob& job : jobs) {
+			if (job.entry.weight == 0)
+				continue;
+
+			entries.push_back(job.entry);
+
+			Move move;
+			move.value = job.entry.move;
+
+			replay(&board, job.line);
+			if (board.mirrored)
+				move = move.mirrored();
+
+			BookNode child = { job.line, SIDES[board.sideToMove] };
+			child.line.push_back(move);
+			nextLevel.push_back(child);
+		}
+
+		__PRINT(format("PLY {}: {} positions searched, {} entries\n", ply, jobs.size(), entries.size()));
+
+		// remove transpositions and finished games from next level
+		level.clear();
+
+		for (BookNode& node : nextLevel) {
+			replay(&board, node.line);
+
+			if ((board.occupancyBySide[!board.sideToMove] & board.wateringHoles).count() >= NUM_WH_TO_WIN)
+				continue;
+
+			if (!seen[node.engine].insert(key_of(&board)).second)
+				continue;
+
+			level.push_back(node);
+		}
+	}
+
+	// close pool
+	{
+		std::lock_guard<std::mutex> lock(queue.lock);
+		queue.closing = true;
+	}
+
+	queue.jobsReady.notify_all();
+
+	for (std::thread& t : threads)
+		t.join();
+
+	board.close();
+
+	if (queue.remaining > 0)
+		throw Exception("Book workers failed, no book written");
+
+	// sort by key, highest weight first
+	std::sort(entries.begin(), entries.end(), [](const BookEntry& a, const BookEntry& b) {
+		return a.key != b.key ? a.key < b.key : a.weight > b.weight;
+	});
+
+	// write file
+	std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+
+	if (!file)
+		throw Exception("Could not write " + filename);
+
+	BookHeader header;
+	header.numEntries = entries.size();
+
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(BookEntry));
+
+	__PRINT(format("{} entries written to {}\n", entries.size(), filename));
+}
+
+} // end namespace Bbot2
@@ -0,0 +1,58 @@
+// book.h
+
+// opening book
+// a sorted binary file of (key, move, weight, eval) entries
+// at runtime, the file is memory-mapped and binary searched before a search is started
+// the file is built offline by Book::build, which runs deep searches over the first plies of the game on a pool of threads
+
+// every position in the book has the engine to move
+// for an engine playing white, positions after its own book move are expanded with every reply, and likewise for black
+// this keeps the book to roughly (legal moves)^(plies / 2) searched positions per side
+
+#pragma once
+
+#include "common.h"
+#include "log.h"
+#include "board.h"
+#include "move.h"
+#include "mappedfile.h"
+
+namespace Bbot2 {
+
+// book entry
+// key is the lower 64 bits of Board::ttKey, so a position and its mirror share entries
+typedef struct BookEntry {
+	unsigned __int64 key;
+	u_short move; // Move::value, mirrored if position was stored under its mirrored key
+	u_short weight; // depth of search that found move. if a key has several entries, the highest weight is played
+	int eval; // evaluation, positive if favouring white (same as Bbot::search_eval)
+} BookEntry;
+
+static_assert(sizeof(BookEntry) == 16, "BookEntry must be packed to 16 bytes");
+
+// file header, followed by numEntries entries sorted by key
+typedef struct BookHeader {
+	char magic[8] = { 'B', 'B', 'O', 'T', '2', 'B', 'K', '2' }; // version 2: keys from fixed-seed mt19937_64 zobrist tables
+	unsigned __int64 numEntries = 0;
+} BookHeader;
+
+
+class Book {
+	MappedFile file;
+
+	const BookEntry* entries = nullptr; // points into mapped file
+	size_t numEntries = 0;
+
+public:
+	bool open(std::string filename);
+	bool is_open();
+	void close();
+
+	bool probe(Board* board, Move* move, int* eval);
+
+	static void build(std::string filename, CSimpleIniA* config, int plies, int maxTime, int maxDepth, int numThreads);
+
+	static unsigned __int64 key_of(Board* board);
+};
+
+} // end namespace Bbot2
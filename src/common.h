@@ -7,6 +7,7 @@
 #include <iostream>
 #include <vector>
 #include <string>
+#include <string_view>
 #include <algorithm>
 #include <format>
 #include <bitset>
@@ -17,23 +18,19 @@ namespace Bbot2 {
 //// CONFIG SETTINGS ////
 
 // log
-const bool LOG = false; // print basic info
-const bool LOG_VERBOSE = false; // print more info
+// levels compiled in. compiled levels are printed up to the runtime level, in .ini [LOG], which is 0 by default
+// a message is only formatted if its level is printed, so a level of 0 costs one check per message
+const bool LOG = true; // basic info
+const bool LOG_VERBOSE = true; // more info
 const bool DEBUG = true; // when throwing an exception, print information that may be helpful
 
-// .ini
-inline std::string INI_FILE = "SETTINGS.ini";
-
-////
+// profile
+const bool PROFILE = false; // time hot paths of the search, see profile.h
+const std::string PROFILE_TRACE_FILE = "profile.json"; // Chrome trace written on exit, if PROFILE
 
-// simpleINI instance shared by most files
-inline CSimpleIniA ini;
-
-// size of hash table. primarily used as a transposition table, but also contains game history 
-// larger values give better performance at a higher memory demand
-// must be form 2^n for hashing purposes
-// shared by Bbot (for TT) and Board (for Zobrist keys). important that this is kept global
-inline unsigned long TT_ALLOC;
+// .ini
+// loaded by main and passed to each class's settings(), so several instances may use different files
+const std::string INI_FILE = "SETTINGS.ini";
 
 ////
 
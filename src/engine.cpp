@@ -0,0 +1,22 @@
+// engine.cpp
+
+#include "engine.h"
+#include "bbot.h"
+#include "mcts.h"
+
+using std::string;
+
+namespace Bbot2 {
+
+// new engine of a type named in .ini, attached to game
+Engine* create_engine(string type, Game* game) {
+	if (type == "alphabeta")
+		return new Bbot(game);
+
+	if (type == "mcts")
+		return new Mcts(game);
+
+	throw Exception("Unknown engine " + type + ", expected alphabeta or mcts");
+}
+
+} // end namespace Bbot2
@@ -0,0 +1,51 @@
+// engine.h
+
+// interface of a computer player, as driven by Game, the GUI, and tournaments
+// implemented by Bbot (alphabeta) and Mcts (Monte Carlo tree search)
+
+// search is stepped: each call of search does a bounded amount of work and returns true while still searching,
+// so a caller on the GUI thread stays responsive. once it returns false, suggested_move holds the move to play
+
+#pragma once
+
+#include "common.h"
+#include "log.h"
+#include "move.h"
+
+namespace Bbot2 {
+
+class Game;
+
+class Engine {
+public:
+	virtual ~Engine() = default;
+
+	virtual void settings(CSimpleIniA* config) = 0;
+	virtual void init() = 0;
+	virtual void attach_game(Game* game_) = 0;
+	virtual void release_game() = 0;
+
+	virtual bool search(int maxTime, int maxDepth) = 0;
+	virtual void search_abort() = 0;
+
+	virtual void on_move_played(Move move) = 0;
+
+	virtual std::string search_eval() = 0;
+	virtual std::string search_PV() = 0;
+	virtual bool search_ongoing() = 0;
+	virtual int search_depth() = 0;
+	virtual float search_score() = 0;
+	virtual double search_duration() = 0;
+	virtual int search_speed() = 0; // in units of search_speed_unit per sec
+	virtual std::string search_speed_unit() { return "nodes"; }
+	virtual Move suggested_move() = 0;
+
+	virtual void soft_close() = 0;
+	virtual void close() = 0;
+};
+
+// new engine of a type named in .ini, attached to game
+// "alphabeta" or "mcts". to be deleted by caller
+Engine* create_engine(std::string type, Game* game);
+
+} // end namespace Bbot2
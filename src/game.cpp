@@ -15,9 +15,9 @@ Game::Game(Board* board_)
 ////
 
 // get settings from .ini
-void Game::settings() {
-	searchMaxTime = std::stoi(string(ini.GetValue("COMPUTER_PLAYER", "time-limit")));
-	searchMaxDepth = std::stoi(string(ini.GetValue("COMPUTER_PLAYER", "depth-limit")));
+void Game::settings(CSimpleIniA* config) {
+	searchMaxTime = std::stoi(string(config->GetValue("COMPUTER_PLAYER", "time-limit")));
+	searchMaxDepth = std::stoi(string(config->GetValue("COMPUTER_PLAYER", "depth-limit")));
 }
 
 // init
@@ -68,8 +68,8 @@ void Game::attach_board(Board* board_) {
 	}
 }
 
-// attach Bbot to either white or black. if none assigned, a user player is the default
-void Game::add_player(Bbot* comp, Side side) {
+// attach engine to either white or black. if none assigned, a user player is the default
+void Game::add_player(Engine* comp, Side side) {
 	players[side] = comp;
 }
 
@@ -82,7 +82,7 @@ void Game::update() {
 		return;
 
 	// search
-	Bbot* comp = players[board->sideToMove];
+	Engine* comp = players[board->sideToMove];
 	comp->search(searchMaxTime, searchMaxDepth);
 
 	// play move is search has exited
@@ -93,10 +93,12 @@ void Game::update() {
 	// to be read by GUI
 	searching = comp->search_ongoing();
 	searchEval = comp->search_eval();
+	searchScore = comp->search_score();
 	searchPV = comp->search_PV();
 	searchDepth = comp->search_depth();
 	searchDuration = comp->search_duration();
 	searchSpeed = comp->search_speed();
+	searchSpeedUnit = comp->search_speed_unit();
 }
 
 ////
@@ -109,18 +111,24 @@ void Game::play_move(Move move) {
 	// get piece
 	Piece* p = board->pointerBoard[move.get_from()];
 
-	__DEBUG(!user_to_play() && p == nullptr, "Computer tried to move with no piece at origin: " + board->move_to_string(move));
-	__DEBUG(!user_to_play() && !p->moveBoard[move.get_to()], "Computer tried to play illegal move: " + board->move_to_string(move));
-
 	// exit if invalid 'from'
-	if (p == nullptr)
+	// messages are only built on failure
+	if (p == nullptr) {
+		if (!user_to_play())
+			__DEBUG(true, "Computer tried to move with no piece at origin: " + board->move_to_string(move));
+
 		return;
+	}
 
 	// check if 'to' is found in legal move set
-	if (!p->moveBoard[move.get_to()])
+	if (!p->moveBoard[move.get_to()]) {
+		if (!user_to_play())
+			__DEBUG(true, "Computer tried to play illegal move: " + board->move_to_string(move));
+
 		return;
+	}
 
-	__LOG(format("[{}]: {}", SIDE_NAMES[board->sideToMove], board->move_to_string(move)));
+	__LOG("[{}]: {}", SIDE_NAMES[board->sideToMove], board->move_to_string(move));
 
 	// play move on board
 	board->move_piece(p, move.get_to());
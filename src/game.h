@@ -1,6 +1,6 @@
 // game.h
 
-// Game class, contains board and manages computer players
+// Game class, contains board and manages computer players, see engine.h
 // informs GUI class
 // also responsible for history, detecting repetition, and finding game-over
 
@@ -8,12 +8,12 @@
 
 #include "common.h"
 #include "log.h"
-#include "bbot.h"
+#include "engine.h"
 #include "board.h"
 
 namespace Bbot2 {
 
-class Bbot;
+class Engine;
 
 // Game History entry
 
@@ -53,7 +53,7 @@ public:
 
 	// board
 	Board* board;
-	Bbot* players[NUM_SIDES] = { nullptr, nullptr }; // Bbot* for computer, nullptr for user
+	Engine* players[NUM_SIDES] = { nullptr, nullptr }; // engine for computer, nullptr for user
 	Outcome outcome = OUTCOME_NONE; // WIN_WHITE, WIN_BLACK, DRAW_BY_REP, or OUTCOME_NONE if game still ongoing
 
 	LineVector playedLine; // canonical line of moves played in game so far
@@ -63,10 +63,12 @@ public:
 	// search info
 	bool searching;
 	std::string searchEval = "0";
+	float searchScore = 0; // searchEval as a number, see Bbot::search_score
 	std::string searchPV;
 	int searchDepth;
 	double searchDuration;
 	int searchSpeed;
+	std::string searchSpeedUnit = "nodes"; // of searchSpeed, per sec
 
 	// true for one cycle if move was played
 	// triggers an update for GUI
@@ -77,11 +79,11 @@ public:
 
 	Game(Board* board_);
 
-	void settings();
+	void settings(CSimpleIniA* config);
 	void init();
 	void reset();
 	void attach_board(Board* board_);
-	void add_player(Bbot* comp, Side side);
+	void add_player(Engine* comp, Side side);
 
 	void update();
 
@@ -0,0 +1,288 @@
+// gamedb.cpp
+
+#include "gamedb.h"
+#include "game.h"
+
+using std::string;
+using std::vector;
+using std::format;
+
+namespace Bbot2 {
+
+// GameWriter //
+
+// open games file for appending, creating it if missing
+void GameWriter::open(string filename) {
+	GamesHeader expected;
+
+	// check header of existing file
+	std::ifstream existing(filename, std::ios::binary | std::ios::ate);
+	bool isNew = !existing || existing.tellg() == 0;
+
+	if (!isNew) {
+		GamesHeader header;
+		existing.seekg(0);
+
+		if (!existing.read(reinterpret_cast<char*>(&header), sizeof(header)) || memcmp(header.magic, expected.magic, sizeof(expected.magic)) != 0)
+			throw Exception(filename + " is not a games file");
+	}
+
+	existing.close();
+
+	file.open(filename, std::ios::binary | std::ios::app);
+
+	if (!file)
+		throw Exception("Could not write " + filename);
+
+	if (isNew)
+		file.write(reinterpret_cast<const char*>(&expected), sizeof(expected));
+}
+
+// append played line of game, from the start position of its board
+void GameWriter::write(Game* game) {
+	Board* board = game->board;
+	GameRecord record;
+	int count[NUM_HERDS] = { 0 };
+
+	// start position, in PackedBoard order
+	for (int k = 0; k < NUM_SQUARES; k ++) {
+		Piece* p = board->startPointerBoard[k];
+
+		if (p == nullptr)
+			continue;
+
+		if (count[p->herd] >= PIECES_PER_HERD)
+			throw Exception("Games file requires " + std::to_string(PIECES_PER_HERD) + " pieces per herd");
+
+		record.start.squares[p->herd * PIECES_PER_HERD + count[p->herd] ++] = (u_byte) k;
+	}
+
+	for (int herd = 0; herd < NUM_HERDS; herd ++)
+		if (count[herd] != PIECES_PER_HERD)
+			throw Exception("Games file requires " + std::to_string(PIECES_PER_HERD) + " pieces per herd");
+
+	int numMoves = game->playedLine.length;
+
+	record.numMoves = (u_short) numMoves;
+	record.outcome = (u_byte) game->outcome;
+	record.sideToMove = (u_byte) (board->sideToMove ^ (numMoves % 2));
+
+	file.write(reinterpret_cast<const char*>(&record), sizeof(record));
+	file.write(reinterpret_cast<const char*>(game->playedLine.movesVector.data()), numMoves * sizeof(Move));
+}
+
+// flush and close games file
+void GameWriter::close() {
+	if (file.is_open())
+		file.close();
+}
+
+////////////////////////////////
+
+// GameReader //
+
+// open games file for reading from its first game
+void GameReader::open(string filename) {
+	file.open(filename, std::ios::binary);
+
+	if (!file)
+		throw Exception("Could not load " + filename);
+
+	GamesHeader header, expected;
+
+	if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) || memcmp(header.magic, expected.magic, sizeof(expected.magic)) != 0)
+		throw Exception(filename + " is not a games file");
+
+	nextOffset = sizeof(GamesHeader);
+}
+
+// read next game into record and moves
+// returns false at end of file
+bool GameReader::next() {
+	if (!file.read(reinterpret_cast<char*>(&record), sizeof(record)))
+		return false;
+
+	moves.resize(record.numMoves);
+
+	if (!file.read(reinterpret_cast<char*>(moves.data()), record.numMoves * sizeof(Move)))
+		throw Exception(format("Games file ends within game at offset {}", nextOffset));
+
+	offset = nextOffset;
+	nextOffset += sizeof(record) + record.numMoves * sizeof(Move);
+
+	return true;
+}
+
+// read game at file offset, see GameIndex::offset_of
+// returns false if there is no game at offset
+bool GameReader::read_at(unsigned __int64 offset_) {
+	file.clear();
+	file.seekg(offset_);
+	nextOffset = offset_;
+
+	return next();
+}
+
+// set up board at ply of last game read
+void GameReader::replay(Board* board, int ply) {
+	board->unpack(record.start, SIDES[record.sideToMove]);
+
+	for (int i = 0; i < ply && i < record.numMoves; i ++) {
+		Piece* p = board->pointerBoard[moves[i].get_from()];
+
+		if (p == nullptr)
+			throw Exception(format("Invalid move {} in game at offset {}", i, offset));
+
+		board->move_piece(p, moves[i].get_to());
+	}
+
+	board->update_move_sets();
+	board->ply = (std::min)(ply, (int) record.numMoves);
+}
+
+// close games file
+void GameReader::close() {
+	if (file.is_open())
+		file.close();
+}
+
+////////////////////////////////
+
+// GameIndex //
+
+// map index of games file into memory
+// returns false if index is missing or not valid
+bool GameIndex::open(string gamesFile) {
+	close();
+
+	if (!file.open(index_file(gamesFile)))
+		return false;
+
+	const GameIndexHeader* header = static_cast<const GameIndexHeader*>(file.data());
+	GameIndexHeader expected;
+
+	if (file.size() < sizeof(GameIndexHeader) || memcmp(header->magic, expected.magic, sizeof(expected.magic)) != 0
+		|| file.size() < sizeof(GameIndexHeader) + header->numGames * sizeof(unsigned __int64) + header->numEntries * sizeof(GameIndexEntry)) {
+		close();
+		return false;
+	}
+
+	numGames = static_cast<size_t>(header->numGames);
+	numEntries = static_cast<size_t>(header->numEntries);
+
+	const char* p = static_cast<const char*>(file.data()) + sizeof(GameIndexHeader);
+	offsets = reinterpret_cast<const unsigned __int64*>(p);
+	entries = reinterpret_cast<const GameIndexEntry*>(p + numGames * sizeof(unsigned __int64));
+
+	return true;
+}
+
+// unmap index
+void GameIndex::close() {
+	file.close();
+
+	offsets = nullptr;
+	entries = nullptr;
+	numGames = 0;
+	numEntries = 0;
+}
+
+// every (game, ply) at which position with key occurs, by game
+vector<GameIndexEntry> GameIndex::find(unsigned __int64 key) {
+	const GameIndexEntry* end = entries + numEntries;
+	const GameIndexEntry* e = std::lower_bound(entries, end, key,
+		[](const GameIndexEntry& a, unsigned __int64 k) { return a.key < k; });
+
+	vector<GameIndexEntry> found;
+
+	for (; e < end && e->key == key; e ++)
+		found.push_back(*e);
+
+	return found;
+}
+
+// file offset of game in games file, for GameReader::read_at
+unsigned __int64 GameIndex::offset_of(unsigned int game) {
+	if (game >= numGames)
+		throw Exception(format("No game {} in index", game));
+
+	return offsets[game];
+}
+
+// number of games indexed
+size_t GameIndex::games() {
+	return numGames;
+}
+
+////
+
+// build index of every position of every game in games file
+// replays games on a board without setting up positions from strings
+// entries are held in memory until written, 16 bytes per position
+void GameIndex::build(string gamesFile) {
+	GameReader reader;
+	reader.open(gamesFile);
+
+	Board board;
+	board.init();
+
+	vector<unsigned __int64> gameOffsets;
+	vector<GameIndexEntry> indexEntries;
+
+	while (reader.next()) {
+		unsigned int game = (unsigned int) gameOffsets.size();
+		gameOffsets.push_back(reader.offset);
+
+		board.unpack(reader.record.start, SIDES[reader.record.sideToMove]);
+		indexEntries.push_back({ key_of(&board), game, 0 });
+
+		for (int i = 0; i < reader.record.numMoves; i ++) {
+			Move m = reader.moves[i];
+			Piece* p = board.pointerBoard[m.get_from()];
+
+			if (p == nullptr)
+				throw Exception(format("Invalid move {} in game {} of {}", i, game, gamesFile));
+
+			board.move_piece(p, m.get_to());
+			indexEntries.push_back({ key_of(&board), game, (u_short) (i + 1) });
+		}
+	}
+
+	reader.close();
+	board.close();
+
+	std::sort(indexEntries.begin(), indexEntries.end(), [](const GameIndexEntry& a, const GameIndexEntry& b) {
+		return a.key != b.key ? a.key < b.key : a.game != b.game ? a.game < b.game : a.ply < b.ply;
+	});
+
+	// write file
+	string filename = index_file(gamesFile);
+	std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+
+	if (!out)
+		throw Exception("Could not write " + filename);
+
+	GameIndexHeader header;
+	header.numGames = gameOffsets.size();
+	header.numEntries = indexEntries.size();
+
+	out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	out.write(reinterpret_cast<const char*>(gameOffsets.data()), gameOffsets.size() * sizeof(unsigned __int64));
+	out.write(reinterpret_cast<const char*>(indexEntries.data()), indexEntries.size() * sizeof(GameIndexEntry));
+
+	__PRINT(format("{} games, {} positions indexed in {}\n", gameOffsets.size(), indexEntries.size(), filename));
+}
+
+////
+
+// index file of games file
+string GameIndex::index_file(string gamesFile) {
+	return gamesFile + ".idx";
+}
+
+// index key of current position of board
+unsigned __int64 GameIndex::key_of(Board* board) {
+	return (board->key & Key(0xFFFFFFFFFFFFFFFF)).to_ullong();
+}
+
+} // end namespace Bbot2
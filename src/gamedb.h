@@ -0,0 +1,113 @@
+// gamedb.h
+
+// game database
+// games are appended to a binary games file, each as a record of its start position and result, followed by its moves
+// an index of every position of every game can be built offline, to find all games through a position
+
+// games file: GamesHeader, then for every game a GameRecord followed by numMoves Move::values (2 bytes each)
+// index file (games file + ".idx"): GameIndexHeader, file offset of every game, then GameIndexEntries sorted by key
+// the index is memory-mapped and binary searched in place, like Book
+
+// all values are stored in native byte order
+
+#pragma once
+
+#include "common.h"
+#include "log.h"
+#include "board.h"
+#include "move.h"
+#include "mappedfile.h"
+#include <fstream>
+
+namespace Bbot2 {
+
+class Game;
+
+static_assert(sizeof(Move) == 2, "Moves are stored as Move::value");
+
+// games file header
+typedef struct GamesHeader {
+	char magic[8] = { 'B', 'B', 'O', 'T', '2', 'G', 'M', '1' };
+} GamesHeader;
+
+// game, followed by its moves in the games file
+typedef struct GameRecord {
+	u_short numMoves = 0;
+	u_byte outcome = OUTCOME_NONE; // Outcome
+	u_byte sideToMove = WHITE; // of start position
+	PackedBoard start;
+} GameRecord;
+
+static_assert(sizeof(GameRecord) == 4 + NUM_PIECES, "GameRecord must be packed");
+
+// index file header, followed by numGames file offsets and numEntries entries
+typedef struct GameIndexHeader {
+	char magic[8] = { 'B', 'B', 'O', 'T', '2', 'G', 'I', '1' };
+	unsigned __int64 numGames = 0;
+	unsigned __int64 numEntries = 0;
+} GameIndexHeader;
+
+// position of a game
+// key is the lower 64 bits of Board::key, so mirrored positions are distinct
+typedef struct GameIndexEntry {
+	unsigned __int64 key;
+	unsigned int game; // index of game in games file
+	u_short ply; // number of moves played before position
+	u_short unused = 0;
+} GameIndexEntry;
+
+static_assert(sizeof(GameIndexEntry) == 16, "GameIndexEntry must be packed to 16 bytes");
+
+
+// appends games to a games file
+class GameWriter {
+	std::ofstream file;
+
+public:
+	void open(std::string filename);
+	void write(Game* game);
+	void close();
+};
+
+// reads games from a games file, one at a time
+class GameReader {
+	std::ifstream file;
+	unsigned __int64 nextOffset = 0;
+
+public:
+	// last game read
+	GameRecord record;
+	std::vector<Move> moves;
+	unsigned __int64 offset = 0; // in games file
+
+	void open(std::string filename);
+	bool next();
+	bool read_at(unsigned __int64 offset_);
+	void replay(Board* board, int ply);
+	void close();
+};
+
+// index of a games file, see GameIndex::build
+class GameIndex {
+	MappedFile file;
+
+	const unsigned __int64* offsets = nullptr; // file offset of each game, points into mapped file
+	const GameIndexEntry* entries = nullptr; // points into mapped file
+	size_t numGames = 0;
+	size_t numEntries = 0;
+
+public:
+	bool open(std::string gamesFile);
+	void close();
+
+	std::vector<GameIndexEntry> find(unsigned __int64 key);
+	unsigned __int64 offset_of(unsigned int game);
+	size_t games();
+
+	static void build(std::string gamesFile);
+
+	static std::string index_file(std::string gamesFile);
+	static unsigned __int64 key_of(Board* board);
+};
+
+} // end namespace Bbot2
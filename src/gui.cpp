@@ -1,6 +1,7 @@
 // gui.cpp
 
 #include "gui.h"
+#include <cmath>
 
 using std::string;
 using std::format;
@@ -12,7 +13,7 @@ namespace Bbot2 {
 
 // constructor
 GUI::GUI(Game* game_)
-	: game(game_) {
+	: game(game_), moveList(COLOUR_COORD, this) {
 
 	board = game->board;
 	pieces = board->pieces;
@@ -21,32 +22,36 @@ GUI::GUI(Game* game_)
 ////
 
 // get settings from .ini
-void GUI::settings() {
+void GUI::settings(CSimpleIniA* config) {
 
 	// perspective
-	string s = string(ini.GetValue("GAME", "perspective"));
+	string s = string(config->GetValue("GAME", "perspective"));
 
 	PERSPECTIVE = PERSPECTIVE_AUTO;
 	if (s == "white") PERSPECTIVE = PERSPECTIVE_FIXED_WHITE;
 	if (s == "black") PERSPECTIVE = PERSPECTIVE_FIXED_BLACK;
 
 	// layout
-	SCREEN_WIDTH =		std::stoi(string(ini.GetValue("LAYOUT", "screen-width")));
-	SCREEN_HEIGHT =		std::stoi(string(ini.GetValue("LAYOUT", "screen-height")));
+	SCREEN_WIDTH =		std::stoi(string(config->GetValue("LAYOUT", "screen-width")));
+	SCREEN_HEIGHT =		std::stoi(string(config->GetValue("LAYOUT", "screen-height")));
 
-	MIN_GAME_SIZE =		std::stoi(string(ini.GetValue("LAYOUT", "min-game-size")));
-	INFO_BOX_HEIGHT =	std::stoi(string(ini.GetValue("LAYOUT", "info-box-height")));
-	MARGIN =			std::stoi(string(ini.GetValue("LAYOUT", "margin")));
+	MIN_GAME_SIZE =		std::stoi(string(config->GetValue("LAYOUT", "min-game-size")));
+	INFO_BOX_HEIGHT =	std::stoi(string(config->GetValue("LAYOUT", "info-box-height")));
+	MARGIN =			std::stoi(string(config->GetValue("LAYOUT", "margin")));
 
-	FONT_SIZE =			std::stoi(string(ini.GetValue("LAYOUT", "font-size")));
+	FONT_SIZE =			std::stoi(string(config->GetValue("LAYOUT", "font-size")));
 
 	// controls
-	PREV_POS_KEYCODE =	SDL_GetKeyFromName(ini.GetValue("CONTROLS", "prev-pos-key"));
-	NEXT_POS_KEYCODE =	SDL_GetKeyFromName(ini.GetValue("CONTROLS", "next-pos-key"));
-	RESET_KEYCODE =		SDL_GetKeyFromName(ini.GetValue("CONTROLS", "reset-key"));
+	PREV_POS_KEYCODE =	SDL_GetKeyFromName(config->GetValue("CONTROLS", "prev-pos-key"));
+	NEXT_POS_KEYCODE =	SDL_GetKeyFromName(config->GetValue("CONTROLS", "next-pos-key"));
+	RESET_KEYCODE =		SDL_GetKeyFromName(config->GetValue("CONTROLS", "reset-key"));
+	ANALYSIS_KEYCODE =	SDL_GetKeyFromName(config->GetValue("CONTROLS", "analysis-key", "a"));
 
-	if (PREV_POS_KEYCODE == SDLK_UNKNOWN || NEXT_POS_KEYCODE == SDLK_UNKNOWN || RESET_KEYCODE == SDLK_UNKNOWN)
+	if (PREV_POS_KEYCODE == SDLK_UNKNOWN || NEXT_POS_KEYCODE == SDLK_UNKNOWN || RESET_KEYCODE == SDLK_UNKNOWN || ANALYSIS_KEYCODE == SDLK_UNKNOWN)
 		throw Exception(INI_FILE + " - Invalid key name");
+
+	// analysis engine
+	analysis.settings(config);
 }
 
 // initialize
@@ -58,6 +63,16 @@ void GUI::init() {
 	// initialize SDL
 	init_SDL();
 
+	// analysis wakes event handler with an event of its own
+	analysisEvent = SDL_RegisterEvents(1);
+	analysis.on_update = [this]() {
+		SDL_Event e = {};
+		e.type = analysisEvent;
+		SDL_PushEvent(&e); // thread safe
+	};
+
+	analysis.init();
+
 	window_resized(SCREEN_WIDTH, SCREEN_HEIGHT); // sets layout values
 
 	// load textures, fonts, cursors
@@ -65,6 +80,7 @@ void GUI::init() {
 
 	// initialize text objects
 	init_text();
+	moveList.clear();
 
 	// copy display board
 	std::copy(board->pointerBoard, &board->pointerBoard[NUM_SQUARES], displayBoard);
@@ -74,6 +90,7 @@ void GUI::init() {
 
 	// initial board orientation
 	flipBoard = PERSPECTIVE == PERSPECTIVE_FIXED_BLACK;
+	boardChanged = true;
 }
 
 // reset
@@ -84,12 +101,20 @@ void GUI::reset() {
 
 	// reset text
 	init_text();
+	moveList.clear();
 
 	// copy display board
 	std::copy(board->pointerBoard, &board->pointerBoard[NUM_SQUARES], displayBoard);
 
 	// display move index
 	posIndex = 0;
+
+	evalHistory.clear();
+
+	if (analysing)
+		start_analysis();
+
+	redraw = true;
 }
 
 // attach a new game and reset what is necessary
@@ -98,11 +123,20 @@ void GUI::attach_game(Game* game_) {
 	board = game->board;
 	pieces = board->pieces;
 
+	moveList.clear();
+
 	// copy display board
 	std::copy(board->pointerBoard, &board->pointerBoard[NUM_SQUARES], displayBoard);
 
 	// display move index
 	posIndex = 0;
+
+	evalHistory.clear();
+
+	if (analysing)
+		start_analysis();
+
+	redraw = true;
 }
 
 ////
@@ -112,6 +146,12 @@ void GUI::update() {
 	// events
 	handle_events();
 
+	// one score per position
+	evalHistory.resize(game->playedLine.length + 1, NAN);
+
+	// analysis
+	update_analysis();
+
 	// text
 	update_text();
 
@@ -122,16 +162,18 @@ void GUI::update() {
 ////
 
 // main draw
+// only draws if something shown has changed since the last draw
 void GUI::draw() {
-	// clear screen
-	SDL_SetRenderDrawColor(renderer, COLOUR_BG.r, COLOUR_BG.g, COLOUR_BG.b, COLOUR_BG.a);
-	SDL_RenderClear(renderer);
+	if (!redraw)
+		return;
 
-	// render texture to screen
-	//SDL_RenderCopy(renderer, pieceTextures[0], NULL, NULL);
-	draw_squares();
+	// static board, only rendered again after a resize or flip
+	if (boardChanged)
+		render_board();
 
-	draw_coords();
+	SDL_RenderCopy(renderer, boardTexture, NULL, NULL);
+
+	draw_highlights();
 
 	draw_pieces();
 
@@ -139,6 +181,9 @@ void GUI::draw() {
 
 	// update screen
 	SDL_RenderPresent(renderer);
+
+	// text rendered again while drawing is already shown
+	redraw = false;
 }
 
 ////
@@ -150,6 +195,9 @@ bool GUI::loop_end() {
 
 // free all resources, quit SDL
 void GUI::close() {
+	// stop analysis thread first, as it pushes SDL events
+	analysis.close();
+
 	// free resources
 	free_resources();
 
@@ -208,6 +256,7 @@ void GUI::load_resources() {
 
 	// font
 	font = TTF_OpenFont((RESOURCES_FOLDER + FONT_FILE).c_str(), FONT_SIZE);
+	glyphAtlas.init(this);
 
 
 	// system cursors
@@ -280,10 +329,15 @@ SDL_Texture* GUI::add_texture(SDL_Texture* t) {
 ////
 
 // main event handler
+// if no search is running, sleeps until the first event or IDLE_WAIT_MS, so an idle GUI leaves the CPU alone
+// live analysis runs on its own thread, and wakes the handler with analysisEvent
 void GUI::handle_events() {
+	bool wait = game->game_over() || game->user_to_play();
 
 	// event queue
-	while (SDL_PollEvent(&event)) {
+	while (wait ? SDL_WaitEventTimeout(&event, IDLE_WAIT_MS) : SDL_PollEvent(&event)) {
+		wait = false;
+
 		switch (event.type) {
 			case SDL_QUIT: // quit
 				quit_event();
@@ -291,22 +345,35 @@ void GUI::handle_events() {
 
 			case SDL_MOUSEMOTION: 
 				on_mouse_move_event(); // mouse move
+				redraw |= grabbed != nullptr; // grabbed piece and hover follow mouse
 				break; 
 			case SDL_MOUSEBUTTONDOWN: // mouse button down
 				on_mouse_down_event();
+				redraw = true;
 				break; 
 			case SDL_MOUSEBUTTONUP: // mouse button up
 				on_mouse_up_event();
+				redraw = true;
 				break; 
 
 			case SDL_KEYDOWN: // key down
 				on_key_down_event(event.key.keysym.sym);
+				redraw = true;
 				break;
 
 			case SDL_WINDOWEVENT: // window resized
 				// supposed to be continuous according to documentation, seems to be broken in current SDL2
 				if (event.window.event == SDL_WINDOWEVENT_SIZE_CHANGED)
 					window_resized(event.window.data1, event.window.data2);
+
+				if (event.window.event == SDL_WINDOWEVENT_EXPOSED)
+					redraw = true;
+				break;
+
+			case SDL_RENDER_TARGETS_RESET: // boardTexture contents lost
+			case SDL_RENDER_DEVICE_RESET:
+				boardChanged = true;
+				redraw = true;
 				break;
 		}
 	}
@@ -411,6 +478,10 @@ void GUI::on_key_down_event(SDL_Keycode keycode) {
 		reset();
 		__LOG("\nRESET COMPLETE");
 	}
+
+	// live analysis
+	if (keycode == ANALYSIS_KEYCODE)
+		toggle_analysis();
 }
 
 
@@ -447,6 +518,9 @@ void GUI::window_resized(int width, int height) {
 	// round game width/height to the nearest BOARD_SIZE for easier drawing/calculation
 	GAME_WIDTH = SQUARE_WIDTH * BOARD_SIZE;
 	GAME_HEIGHT = SQUARE_HEIGHT * BOARD_SIZE;
+
+	boardChanged = true;
+	redraw = true;
 }
 
 void GUI::quit_event() {
@@ -468,18 +542,29 @@ void GUI::on_move_played() {
 	grabbed = nullptr;
 	selected = nullptr;
 
+	// score of position before move, from computer that played it, unless analysed
+	int before = game->playedLine.length - 1;
+	evalHistory.resize(game->playedLine.length + 1, NAN);
+
+	if (game->players[!board->sideToMove] != nullptr && std::isnan(evalHistory[before]))
+		evalHistory[before] = game->searchScore;
+
 	// update display board
 	to_pos(game->playedLine.length);
 
 	// flip board if needed
-	if (PERSPECTIVE == PERSPECTIVE_AUTO && game->user_to_play())
+	if (PERSPECTIVE == PERSPECTIVE_AUTO && game->user_to_play() && flipBoard != (bool) board->sideToMove) {
 		flipBoard = board->sideToMove;
+		boardChanged = true;
+	}
 
 	game->movePlayed = false;
+	redraw = true;
 }
 
 // set played line index, determining what position of the game to show
 void GUI::to_pos(int i) {
+	int from = posIndex;
 
 	// traverse through played line until arrived at current position
 	Move m;
@@ -496,6 +581,10 @@ void GUI::to_pos(int i) {
 		displayBoard[m.get_to()] = nullptr;
 		posIndex --;
 	}
+
+	// analyse new position
+	if (analysing && posIndex != from)
+		start_analysis();
 }
 
 // if the board being displayed is current
@@ -505,6 +594,63 @@ bool GUI::is_display_current() {
 
 ////
 
+// start or stop live analysis
+void GUI::toggle_analysis() {
+	analysing = !analysing;
+
+	if (analysing) {
+		start_analysis();
+	} else {
+		analysis.stop();
+		analysisId = 0;
+	}
+
+	redraw = true;
+}
+
+// analyse displayed position, replacing any previous analysis
+void GUI::start_analysis() {
+	analysisPos = posIndex;
+
+	// nothing to search once the game is over
+	if (is_display_current() && game->game_over()) {
+		analysis.stop();
+		analysisId = 0;
+		return;
+	}
+
+	// displayed position, counted back from the current one
+	int back = game->playedLine.length - posIndex;
+	int herds[NUM_SQUARES];
+
+	for (int i = 0; i < NUM_SQUARES; i ++)
+		herds[i] = displayBoard[i] == nullptr ? -1 : displayBoard[i]->herd;
+
+	char buffer[Board::COMPACT_MAX_LEN];
+	size_t len = Board::write_compact(herds, SIDES[board->sideToMove ^ (back % NUM_SIDES)], board->ply - back, buffer);
+
+	analysisId = analysis.start(string(buffer, len));
+}
+
+// read latest analysis snapshot, without waiting on the search
+void GUI::update_analysis() {
+	if (!analysing)
+		return;
+
+	const AnalysisSnapshot& s = analysis.snapshot();
+
+	// ignore snapshots of previous positions
+	if (s.id != analysisId || s.depth == 0 || analysisPos >= evalHistory.size())
+		return;
+
+	if (evalHistory[analysisPos] != s.score) {
+		evalHistory[analysisPos] = s.score;
+		redraw = true;
+	}
+}
+
+////
+
 // create all text items
 void GUI::init_text() {
 
@@ -522,20 +668,37 @@ void GUI::init_text() {
 	//	[0] - "SEARCHING..." if search is active
 	//	[1] - eval from last computer to play
 	//	[2] - PV from last computer to play
-	//	[3] - played line
-	//  [4] - nodes/sec
+	//	[3] - nodes/sec
 
 	infoText.clear();
-	for (int i = 0; i < 5; i ++)
+	for (int i = 0; i < 4; i ++)
 		infoText.push_back(Text("", 0, 0, 0, TTF_WRAPPED_ALIGN_LEFT, COLOUR_TEXT, this));
 
-	infoText[3].colour = COLOUR_COORD;
-	infoText[4].align = TTF_WRAPPED_ALIGN_RIGHT;
+	infoText[3].align = TTF_WRAPPED_ALIGN_RIGHT;
 }
 
 // write contents of text
 void GUI::update_text() {
-	if (game->game_over()) {
+
+	// moves played since last update
+	moveList.update();
+
+	if (analysing && analysisId != 0) {
+
+		// latest analysis of displayed position
+		const AnalysisSnapshot& s = analysis.snapshot();
+		bool current = s.id == analysisId;
+
+		infoText[0].write(!current || s.searching ? "ANALYSING..." : "ANALYSIS COMPLETE");
+		infoText[1].write(current ? format("EVAL: {}, DEPTH: {}", s.eval, s.depth) : "");
+		// next best lines under PV, with multipv
+		string PVs = s.PV;
+		for (const string& line : s.lines)
+			PVs += "\n" + line;
+
+		infoText[2].write(current ? PVs : "");
+		infoText[3].write(current ? format("{} nodes/sec", s.speed) : "");
+	} else if (game->game_over()) {
 
 		// text for end of game
 		infoText[0].write("");
@@ -548,19 +711,40 @@ void GUI::update_text() {
 		}
 
 		infoText[2].write(format("Press '{}' to reset", string(SDL_GetKeyName(RESET_KEYCODE))));
-		infoText[4].write("");
+		infoText[3].write("");
 	} else {
 
 		// get info about last search from game
 		infoText[0].write(game->searching ? "SEARCHING..." : "");
 		infoText[1].write(format("EVAL: {}, DEPTH: {} ({:.2f}s)", game->searchEval, game->searchDepth, game->searchDuration));
 		infoText[2].write(game->searchPV);
-		infoText[3].write(game->playedLine.to_string(board->startPointerBoard));
-		infoText[4].write(format("{} nodes/sec", game->searchSpeed));
+		infoText[3].write(format("{} {}/sec", game->searchSpeed, game->searchSpeedUnit));
 	}
 }
 
+// render background, squares, watering holes and coordinates to boardTexture
+// these only change on resize or flip, so each draw copies the texture instead
+void GUI::render_board() {
+	if (boardTexture != nullptr)
+		SDL_DestroyTexture(boardTexture);
+
+	boardTexture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, SCREEN_WIDTH, SCREEN_HEIGHT);
+	SDL_SetTextureBlendMode(boardTexture, SDL_BLENDMODE_NONE); // opaque, covers whole screen
 
+	SDL_SetRenderTarget(renderer, boardTexture);
+
+	// clear background
+	SDL_SetRenderDrawColor(renderer, COLOUR_BG.r, COLOUR_BG.g, COLOUR_BG.b, COLOUR_BG.a);
+	SDL_RenderClear(renderer);
+
+	draw_squares();
+
+	draw_coords();
+
+	SDL_SetRenderTarget(renderer, NULL);
+
+	boardChanged = false;
+}
 
 // draw white/black squares that compose the game board
 void GUI::draw_squares() {
@@ -594,10 +778,15 @@ void GUI::draw_squares() {
 
 		SDL_RenderCopy(renderer, whTexture[scalar_to_colour(k)], NULL, &rect);
 	}
+}
 
+// draw last move, forced and threatened squares
+void GUI::draw_highlights() {
 	if (!is_display_current())
 		return;
 
+	SDL_Rect rect = { 0, 0, SQUARE_WIDTH, SQUARE_HEIGHT };
+
 	// highlight last move
 	if (posIndex > 0) {
 		Move move = game->playedLine.get_move(posIndex - 1);
@@ -741,6 +930,56 @@ void GUI::draw_info() {
 		infoText[i].draw();
 		y += infoText[i].textHeight + FONT_SIZE / 2;
 	}
+
+	// eval graph, once any position has a score
+	if (std::any_of(evalHistory.begin(), evalHistory.end(), [](float score) { return !std::isnan(score); })) {
+		draw_eval_graph(MARGIN, y, SCREEN_WIDTH - MARGIN * 2, EVAL_GRAPH_HEIGHT);
+		y += EVAL_GRAPH_HEIGHT + FONT_SIZE / 2;
+	}
+
+	// played line fills the rest of the screen
+	moveList.x = MARGIN;
+	moveList.y = y;
+	moveList.set_width(SCREEN_WIDTH - MARGIN * 2);
+	moveList.height = SCREEN_HEIGHT - MARGIN - y;
+	moveList.draw();
+}
+
+// draw score of every position in played line, white up, with the displayed position marked
+void GUI::draw_eval_graph(int x, int y, int width, int height) {
+	SDL_Rect rect = { x, y, width, height };
+	int n = (int) evalHistory.size();
+
+	// position index to x
+	auto index_to_x = [&](int i) { return x + (n > 1 ? i * (width - 1) / (n - 1) : 0); };
+
+	// background
+	SDL_SetRenderDrawColor(renderer, COLOUR_GRAPH_BG.r, COLOUR_GRAPH_BG.g, COLOUR_GRAPH_BG.b, COLOUR_GRAPH_BG.a);
+	SDL_RenderFillRect(renderer, &rect);
+
+	// zero line and displayed position
+	SDL_SetRenderDrawColor(renderer, COLOUR_GRAPH_AXIS.r, COLOUR_GRAPH_AXIS.g, COLOUR_GRAPH_AXIS.b, COLOUR_GRAPH_AXIS.a);
+	SDL_RenderDrawLine(renderer, x, y + height / 2, x + width - 1, y + height / 2);
+	SDL_RenderDrawLine(renderer, index_to_x(posIndex), y, index_to_x(posIndex), y + height - 1);
+
+	// scores, joined where consecutive positions are known
+	SDL_SetRenderDrawColor(renderer, COLOUR_GRAPH_LINE.r, COLOUR_GRAPH_LINE.g, COLOUR_GRAPH_LINE.b, COLOUR_GRAPH_LINE.a);
+	SDL_Point prev = { 0, 0 };
+
+	for (int i = 0; i < n; i ++) {
+		if (std::isnan(evalHistory[i]))
+			continue;
+
+		float score = std::clamp(evalHistory[i], -EVAL_GRAPH_RANGE, EVAL_GRAPH_RANGE);
+		SDL_Point p = { index_to_x(i), y + height / 2 - (int) (score / EVAL_GRAPH_RANGE * (height / 2 - 1)) };
+
+		if (i > 0 && !std::isnan(evalHistory[i - 1]))
+			SDL_RenderDrawLine(renderer, prev.x, prev.y, p.x, p.y);
+		else
+			SDL_RenderDrawPoint(renderer, p.x, p.y);
+
+		prev = p;
+	}
 }
 
 ////
@@ -783,6 +1022,9 @@ void GUI::free_resources() {
 		SDL_DestroyTexture(t);
 	}
 
+	if (boardTexture != nullptr)
+		SDL_DestroyTexture(boardTexture);
+
 	// free cursors
 	for (int i = 0; i < 3; i ++) {
 		SDL_FreeCursor(cursorList[i]);
@@ -847,6 +1089,8 @@ void GUI::Text::write(string text_) {
 	if (text != text_) {
 		text = text_;
 		render();
+
+		graphics->redraw = true; // shown on next draw
 	}
 }
 
@@ -881,6 +1125,177 @@ void GUI::Text::draw() {
 	SDL_RenderCopy(graphics->renderer, texture, NULL, &destRect);
 }
 
+////////////////////////////////
+
+// GlyphAtlas nested class
+// render printable ASCII characters side by side into one texture
+// glyphs are white, so text of any colour is drawn with a colour mod
+void GUI::GlyphAtlas::init(GUI* graphics) {
+	SDL_Surface* surfaces[128] = {};
+	int width = 0, height = 0;
+
+	for (int c = 0; c < 128; c ++) {
+		glyphs[c] = { 0, 0, 0, 0 };
+		advances[c] = 0;
+
+		if (c < ' ' || c > '~')
+			continue;
+
+		int minX, maxX, minY, maxY;
+		TTF_GlyphMetrics(graphics->font, (Uint16) c, &minX, &maxX, &minY, &maxY, &advances[c]);
+
+		// NULL for glyphs with nothing to draw, such as space
+		surfaces[c] = TTF_RenderGlyph_Blended(graphics->font, (Uint16) c, { 0xFF, 0xFF, 0xFF, 0xFF });
+
+		if (surfaces[c] == NULL)
+			continue;
+
+		glyphs[c] = { width, 0, surfaces[c]->w, surfaces[c]->h };
+		width += surfaces[c]->w;
+		height = (std::max)(height, surfaces[c]->h);
+	}
+
+	// copy glyphs into one surface, keeping their alpha
+	SDL_Surface* atlasSurface = SDL_CreateRGBSurfaceWithFormat(0, (std::max)(width, 1), (std::max)(height, 1), 32, SDL_PIXELFORMAT_RGBA32);
+
+	for (int c = 0; c < 128; c ++) {
+		if (surfaces[c] == NULL)
+			continue;
+
+		SDL_SetSurfaceBlendMode(surfaces[c], SDL_BLENDMODE_NONE);
+		SDL_BlitSurface(surfaces[c], NULL, atlasSurface, &glyphs[c]);
+		SDL_FreeSurface(surfaces[c]);
+	}
+
+	texture = graphics->add_texture(SDL_CreateTextureFromSurface(graphics->renderer, atlasSurface));
+	SDL_FreeSurface(atlasSurface);
+
+	lineHeight = TTF_FontLineSkip(graphics->font);
+}
+
+// width of s when drawn
+int GUI::GlyphAtlas::text_width(const string& s) {
+	int width = 0;
+
+	for (unsigned char c : s)
+		width += c < 128 ? advances[c] : 0;
+
+	return width;
+}
+
+// draw s, one copy per glyph
+void GUI::GlyphAtlas::draw(SDL_Renderer* renderer, const string& s, int x, int y, SDL_Color colour) {
+	SDL_SetTextureColorMod(texture, colour.r, colour.g, colour.b);
+	SDL_SetTextureAlphaMod(texture, colour.a);
+
+	for (unsigned char c : s) {
+		if (c >= 128)
+			continue;
+
+		if (glyphs[c].w > 0) {
+			SDL_Rect destRect = { x, y, glyphs[c].w, glyphs[c].h };
+			SDL_RenderCopy(renderer, texture, &glyphs[c], &destRect);
+		}
+
+		x += advances[c];
+	}
+}
+
+////////////////////////////////
+
+// MoveList nested class
+GUI::MoveList::MoveList(SDL_Color colour_, GUI* graphics_)
+	: colour(colour_), graphics(graphics_) {}
+
+// remove all moves, to follow the played line again from the start position
+void GUI::MoveList::clear() {
+	items.clear();
+	positions.clear();
+	lineStarts.clear();
+	length = 0;
+
+	std::copy(graphics->board->startPointerBoard, &graphics->board->startPointerBoard[NUM_SQUARES], pointerBoard);
+
+	graphics->redraw = true;
+}
+
+// add moves played since last update
+void GUI::MoveList::update() {
+	LineVector& line = graphics->game->playedLine;
+
+	// played line was reset
+	if (line.length < length)
+		clear();
+
+	for (; length < line.length; length ++) {
+		Move move = line.get_move(length);
+
+		// label move number when white is playing, as in Line::to_string
+		string item = move.to_string(pointerBoard);
+
+		if (length % NUM_SIDES == 0)
+			item = std::to_string(length / NUM_SIDES + 1) + ". " + item;
+
+		// follow move, to name the next one
+		pointerBoard[move.get_to()] = pointerBoard[move.get_from()];
+		pointerBoard[move.get_from()] = nullptr;
+
+		items.push_back(item);
+		positions.push_back({ 0, 0 });
+		place(items.size() - 1);
+
+		graphics->redraw = true;
+	}
+}
+
+// lay out all items again if a new width is given
+void GUI::MoveList::set_width(int width_) {
+	if (width == width_)
+		return;
+
+	width = width_;
+
+	for (size_t i = 0; i < items.size(); i ++)
+		place(i);
+}
+
+// draw the last lines that fit in height
+void GUI::MoveList::draw() {
+	if (items.empty())
+		return;
+
+	GlyphAtlas& atlas = graphics->glyphAtlas;
+
+	int numLines = (std::max)(height / atlas.lineHeight, 1);
+	size_t first = lineStarts[lineStarts.size() - (std::min)((size_t) numLines, lineStarts.size())];
+	int top = positions[first].y;
+
+	for (size_t i = first; i < items.size(); i ++)
+		atlas.draw(graphics->renderer, items[i], x + positions[i].x, y + positions[i].y - top, colour);
+}
+
+// lay out item i after item i - 1, wrapping within width
+void GUI::MoveList::place(size_t i) {
+	GlyphAtlas& atlas = graphics->glyphAtlas;
+
+	if (i == 0) {
+		positions[0] = { 0, 0 };
+		lineStarts.assign(1, 0);
+		return;
+	}
+
+	SDL_Point p = positions[i - 1];
+	p.x += atlas.text_width(items[i - 1]) + atlas.advances[' '];
+
+	// wrap to new line
+	if (p.x + atlas.text_width(items[i]) > width) {
+		p = { 0, p.y + atlas.lineHeight };
+		lineStarts.push_back(i);
+	}
+
+	positions[i] = p;
+}
+
 ////
 
 void GUI::__DEBUG(bool condition, string message) {
@@ -9,6 +9,7 @@
 #include "bbot.h"
 #include "board.h"
 #include "game.h"
+#include "liveanalysis.h"
 #include "../external/SDL2-2.26.2/include/SDL.h"
 #include "../external/SDL2_image-2.6.2/include/SDL_image.h"
 #include "../external/SDL2_ttf-2.20.1/include/SDL_ttf.h"
@@ -38,12 +39,22 @@ class GUI {
 	SDL_Keycode PREV_POS_KEYCODE = SDLK_LEFT;
 	SDL_Keycode NEXT_POS_KEYCODE = SDLK_RIGHT;
 	SDL_Keycode RESET_KEYCODE = SDLK_r;
+	SDL_Keycode ANALYSIS_KEYCODE = SDLK_a;
 
 	// *usually overrided by .ini in settings()
 
 	////
 
 
+	//// EVAL GRAPH ////
+	const int EVAL_GRAPH_HEIGHT = 60;
+	const float EVAL_GRAPH_RANGE = 3; // in watering holes, scores beyond are clipped
+
+
+	//// EVENTS ////
+	const int IDLE_WAIT_MS = 250; // longest wait for an event while no search is running
+
+
 	//// COLOURS ////
 	SDL_Color COLOUR_BG =			{ 0x20, 0x20, 0x20, 0xFF }; // background
 	SDL_Color COLOUR_SQUARES[2] = {
@@ -57,6 +68,9 @@ class GUI {
 	SDL_Color COLOUR_LAST_MOVE =	{ 0xFF, 0xFF, 0x88, 0x66 }; // highlight last move
 	SDL_Color COLOUR_COORD =		{ 0xAA, 0xAA, 0xAA, 0xFF }; // coordinate text colour
 	SDL_Color COLOUR_TEXT =			{ 0xFF, 0xFF, 0xFF, 0xFF }; // game info text colour
+	SDL_Color COLOUR_GRAPH_BG =		{ 0x30, 0x30, 0x30, 0xFF }; // eval graph background
+	SDL_Color COLOUR_GRAPH_AXIS =	{ 0x60, 0x60, 0x60, 0xFF }; // eval graph zero line and displayed position
+	SDL_Color COLOUR_GRAPH_LINE =	{ 0xFF, 0xFF, 0xFF, 0xFF }; // eval graph scores
 
 
 	//// RESOURCES ////
@@ -93,6 +107,11 @@ class GUI {
 	SDL_Event event; // address used by event handler
 	bool requestQuit = false; // set true to exit
 
+	// the screen is only drawn when something shown has changed
+	bool redraw = true; // screen is out of date
+	bool boardChanged = true; // boardTexture is out of date
+	SDL_Texture* boardTexture = nullptr; // cached background, squares, watering holes and coordinates
+
 	// texture objects
 	std::vector<SDL_Texture*> textureList; // populated by add_texture, used to de-allocate on close
 	SDL_Texture* pieceTexture;
@@ -111,7 +130,8 @@ class GUI {
 	//	[0] - "SEARCHING..." if search is active
 	//	[1] - eval from last computer to play
 	//	[2] - PV from last computer to play
-	//	[3] - played line
+	//	[3] - nodes/sec
+	// played line is shown by moveList, below infoText
 
 	// cursors
 	SDL_SystemCursor SYSTEM_CURSOR[3] = { SDL_SYSTEM_CURSOR_ARROW, SDL_SYSTEM_CURSOR_WAITARROW, SDL_SYSTEM_CURSOR_HAND };
@@ -126,6 +146,15 @@ class GUI {
 
 	bool flipBoard = false; // false - white's view, true - black's view
 
+	// live analysis of the displayed position, toggled by ANALYSIS_KEYCODE
+	LiveAnalysis analysis;
+	bool analysing = false;
+	unsigned __int64 analysisId = 0; // id of position being analysed, 0 if none
+	int analysisPos = 0; // index of position being analysed, as posIndex
+	Uint32 analysisEvent; // pushed by analysis thread after every snapshot, to wake handle_events
+
+	std::vector<float> evalHistory; // score of every position in played line, from computer players and analysis. NAN if unknown
+
 	int mouseScalar = -1; // scalar of mouse position on board, -1 is off board
 	Piece* selected = nullptr; // points to selected piece (highlighted, showing legal moves)
 	Piece* grabbed = nullptr; // points to grabbed piece (lifted off the board)
@@ -134,7 +163,7 @@ class GUI {
 public:
 	GUI(Game* game_);
 
-	void settings();
+	void settings(CSimpleIniA* config);
 	void init();
 	void reset();
 	void attach_game(Game* game_);
@@ -166,12 +195,19 @@ private:
 	void to_pos(int index);
 	bool is_display_current();
 
+	void toggle_analysis();
+	void start_analysis();
+	void update_analysis();
+
 	void init_text();
 	void update_text();
 
+	void render_board();
 	void draw_squares();
 	void draw_coords();
+	void draw_highlights();
 	void draw_info();
+	void draw_eval_graph(int x, int y, int width, int height);
 	void draw_pieces();
 
 	int scalar_to_x(int k);
@@ -207,6 +243,53 @@ private:
 		void draw();
 	};
 
+	// nested class for a glyph atlas
+	// printable characters are rendered once into one texture, so text that changes often is drawn without rendering it again
+	class GlyphAtlas {
+	public:
+		SDL_Texture* texture = nullptr;
+		SDL_Rect glyphs[128]; // source rect of each character in texture
+		int advances[128]; // horizontal advance of each character
+		int lineHeight = 0;
+
+		void init(GUI* graphics);
+
+		int text_width(const std::string& s);
+		void draw(SDL_Renderer* renderer, const std::string& s, int x, int y, SDL_Color colour);
+	};
+
+	// nested class for the played line
+	// moves are named and laid out once, as they are played, and only the last lines that fit are drawn,
+	// so the cost of a frame does not grow with the length of the game
+	class MoveList {
+	public:
+		std::vector<std::string> items; // move number and move for white, move for black
+		std::vector<SDL_Point> positions; // of items, relative to x, y
+		std::vector<size_t> lineStarts; // index of first item on each line
+		int length = 0; // moves added
+		int x = 0; // coordinates x, y
+		int y = 0;
+		int width = 0; // wrap width
+		int height = 0; // display height
+		SDL_Color colour;
+		Piece* pointerBoard[NUM_SQUARES]; // position after moves added, to name the next move
+		GUI* graphics;
+
+		MoveList(SDL_Color colour_, GUI* graphics_);
+
+		void clear();
+		void update();
+		void set_width(int width_);
+
+		void draw();
+
+	private:
+		void place(size_t i);
+	};
+
+	GlyphAtlas glyphAtlas;
+	MoveList moveList;
+
 	void __DEBUG(bool condition, std::string message);
 };
 
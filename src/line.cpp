@@ -7,17 +7,15 @@ using std::string;
 namespace Bbot2 {
 
 // Line //
-Line::Line(string s) {
-	string t;
-
-	for (size_t i = 0; i < s.size(); i ++) {
+// moves are read from every word starting with a piece char, e.g. "1. Ld2c3 Me9e7", up to MAX_LINE_LEN moves
+Line::Line(std::string_view s) {
+	for (size_t i = 0; i < s.size() && length < MAX_LINE_LEN; i ++) {
 		for (int j = 0; j < NUM_HERDS; j ++) {
 			if (s[i] == BOARD_CHARS[j]) {
-				t = s.substr(i);
-				t = t.substr(0, t.find(' '));
+				size_t end = (std::min)(s.find(' ', i), s.size());
 
-				append(Move(t));
-				i += t.size();
+				append(Move(s.substr(i, end - i)));
+				i = end;
 				break;
 			}
 		}
@@ -20,7 +20,7 @@ public:
 	Move moves[MAX_LINE_LEN];
 
 	Line() = default;
-	Line(std::string s);
+	Line(std::string_view s);
 
 	virtual void append(Move move);
 	virtual Move get_move(int i);
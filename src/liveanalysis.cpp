@@ -0,0 +1,183 @@
+// liveanalysis.cpp
+
+#include "liveanalysis.h"
+
+using std::string;
+
+namespace Bbot2 {
+
+// LiveAnalysis //
+
+// constructor
+LiveAnalysis::LiveAnalysis()
+	: game(&board), comp(&game) {}
+
+// get settings from .ini
+void LiveAnalysis::settings(CSimpleIniA* config) {
+	multiPV = (int) config->GetLongValue("COMPUTER_PLAYER", "multipv", multiPV);
+
+	comp.settings(config);
+}
+
+// initialize engine and start search thread, idle until a position is given
+void LiveAnalysis::init() {
+	board.init();
+	game.init();
+	comp.init();
+
+	thread = std::thread(&LiveAnalysis::run, this);
+}
+
+// analyse position in compact notation, aborting any current search
+// returns id of position, found in its snapshots
+unsigned __int64 LiveAnalysis::start(string position_) {
+	return request(position_);
+}
+
+// abort any current search and idle
+void LiveAnalysis::stop() {
+	request("");
+}
+
+// latest snapshot published
+// only to be called from one thread. the reference stays valid until the next call
+const AnalysisSnapshot& LiveAnalysis::snapshot() {
+	if (middle.load(std::memory_order_acquire) & FRESH)
+		readIndex = middle.exchange(readIndex, std::memory_order_acq_rel) & ~FRESH;
+
+	return snapshots[readIndex];
+}
+
+// stop search thread and close engine
+void LiveAnalysis::close() {
+	if (thread.joinable()) {
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			closing = true;
+			interrupted = true;
+			comp.search_abort();
+		}
+
+		wake.notify_one();
+		thread.join();
+	}
+
+	comp.close();
+	game.close();
+	board.close();
+}
+
+////
+
+// search thread, takes requests until closed
+void LiveAnalysis::run() {
+	while (true) {
+		string position_;
+		unsigned __int64 id;
+
+		{
+			std::unique_lock<std::mutex> guard(lock);
+			wake.wait(guard, [this] { return requested || closing; });
+
+			if (closing)
+				break;
+
+			position_ = position;
+			id = positionId;
+
+			requested = false;
+			interrupted = false;
+		}
+
+		if (position_.empty()) {
+			snapshots[writeIndex] = AnalysisSnapshot();
+			snapshots[writeIndex].id = id;
+			publish();
+		} else {
+			search(position_, id);
+		}
+	}
+}
+
+// search position until max depth, a forced result, or an interruption
+void LiveAnalysis::search(string position_, unsigned __int64 id) {
+
+	// set up position. engine releases the previous one first, as its game history is keyed by it
+	comp.release_game();
+	game.close();
+
+	board.from_compact(position_);
+
+	game.init();
+	comp.attach_game(&game);
+
+	comp.multiPV = multiPV;
+
+	// searching, no iteration complete yet
+	snapshots[writeIndex] = AnalysisSnapshot();
+	snapshots[writeIndex].id = id;
+	snapshots[writeIndex].searching = true;
+	publish();
+
+	while (true) {
+		bool ongoing = comp.search(INT_MAX, maxDepth);
+
+		// abort, and let search exit on its next call. results are for a position no longer wanted
+		if (interrupted) {
+			if (!ongoing)
+				break;
+
+			comp.search_abort();
+			continue;
+		}
+
+		AnalysisSnapshot& s = snapshots[writeIndex];
+		s.id = id;
+		s.searching = ongoing;
+		s.eval = comp.search_eval();
+		s.score = comp.search_score();
+		s.PV = comp.search_PV();
+		s.depth = comp.search_depth();
+
+		s.lines.clear();
+		for (int i = 1; i < comp.search_num_lines(); i ++)
+			s.lines.push_back(comp.search_eval(i) + " " + comp.search_PV(i));
+
+		s.speed = comp.search_speed();
+		publish();
+
+		if (!ongoing)
+			break;
+	}
+}
+
+// replace any waiting request, and interrupt current search
+// returns id of request
+// the abort is made under lock, so it cannot reach a search started for this request
+unsigned __int64 LiveAnalysis::request(string position_) {
+	unsigned __int64 id;
+
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		position = position_;
+		id = ++ positionId;
+		requested = true;
+
+		interrupted = true;
+		comp.search_abort();
+	}
+
+	wake.notify_one();
+
+	return id;
+}
+
+// swap written snapshot into middle, taking the previous middle to write next
+void LiveAnalysis::publish() {
+	writeIndex = middle.exchange(writeIndex | FRESH, std::memory_order_acq_rel) & ~FRESH;
+
+	if (on_update)
+		on_update();
+}
+
+} // end namespace Bbot2
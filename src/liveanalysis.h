@@ -0,0 +1,96 @@
+// liveanalysis.h
+
+// infinite analysis of one position at a time, searched on a background thread
+// used by the GUI to analyse any position it shows, while it keeps handling events
+
+// the search publishes a snapshot after every iteration of iterative deepening. snapshots are triple buffered,
+// so the reader always gets the latest complete one, and neither thread waits on the other to publish or read
+// starting another position aborts the current search
+
+#pragma once
+
+#include "common.h"
+#include "log.h"
+#include "board.h"
+#include "game.h"
+#include "bbot.h"
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <functional>
+
+namespace Bbot2 {
+
+// state of a live analysis after an iteration
+typedef struct AnalysisSnapshot {
+	unsigned __int64 id = 0; // position, as returned by LiveAnalysis::start, 0 if none
+	bool searching = false; // false once search has finished
+	std::string eval = "0";
+	float score = 0; // eval as a number, see Bbot::search_score
+	std::string PV;
+	std::vector<std::string> lines; // with multiPV, the next best lines as "<eval> <PV>"
+	int depth = 0;
+	int speed = 0; // nodes/sec
+} AnalysisSnapshot;
+
+class LiveAnalysis {
+public:
+	////
+
+	//// SETTINGS ////
+
+	int maxDepth = MAX_LINE_LEN; // search is infinite in time, bounded only by depth
+	int multiPV = 1; // lines searched
+
+	// usually overrided by .ini in settings()
+
+	////
+
+	std::function<void()> on_update; // called on the search thread after a snapshot is published, e.g. to wake the GUI
+
+private:
+	Board board;
+	Game game;
+	Bbot comp;
+
+	std::thread thread;
+
+	// requests, guarded by lock
+	std::mutex lock;
+	std::condition_variable wake;
+	std::string position; // compact notation, empty to stop
+	unsigned __int64 positionId = 0;
+	bool requested = false; // position not yet taken by search thread
+	bool closing = false;
+
+	std::atomic<bool> interrupted = false; // a request is waiting, current search should end
+
+	// triple buffer. writer and reader each own one snapshot, middle holds the third
+	AnalysisSnapshot snapshots[3];
+	int writeIndex = 0; // search thread only
+	int readIndex = 1; // reader only
+	std::atomic<int> middle = 2; // index, with FRESH set if not read yet
+	static const int FRESH = 4;
+
+public:
+	LiveAnalysis();
+
+	void settings(CSimpleIniA* config);
+	void init();
+
+	unsigned __int64 start(std::string position_);
+	void stop();
+
+	const AnalysisSnapshot& snapshot();
+
+	void close();
+
+private:
+	void run();
+	void search(std::string position_, unsigned __int64 id);
+	unsigned __int64 request(std::string position_);
+	void publish();
+};
+
+} // end namespace Bbot2
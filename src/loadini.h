@@ -9,23 +9,15 @@
 
 namespace Bbot2 {
 
-void load_INI() {
+inline void load_INI(CSimpleIniA* ini, std::string filename = INI_FILE) {
 
 	// load file
-	ini.SetUnicode();
-	ini.SetMultiLine(true);
-	SI_Error e = ini.LoadFile(INI_FILE.c_str());
+	ini->SetUnicode();
+	ini->SetMultiLine(true);
+	SI_Error e = ini->LoadFile(filename.c_str());
 
 	if (e != SI_OK)
-		throw Exception("Could not load " + INI_FILE);
-
-	// transposition table allocation
-	TT_ALLOC = std::stoi(std::string(ini.GetValue("COMPUTER_PLAYER", "transposition-table-allocation")));
-
-	// round to nearest 2^n
-	u_long n = 1;
-	while (n < TT_ALLOC) n <<= 1;
-	TT_ALLOC = n;
+		throw Exception("Could not load " + filename);
 }
 
 } // end namespace Bbot2
@@ -1,8 +1,10 @@
 // log.cpp
 
-#pragma once
-
 #include "log.h"
+#include <fstream>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
 
 using std::string;
 using std::format;
@@ -10,37 +12,148 @@ using std::format;
 namespace Bbot2 {
 
 void __PRINT(string message) {
-	std::cout << message;
+	Log::write(message, true);
 }
 
-void __LOG(string message) {
-	if constexpr (LOG)
-		__PRINT(message + "\n");
+void Exception::print() {
+	__PRINT(format("ERROR: {}\n{}({}:{}) in {}\n", message, location.file_name(), location.line(), location.column(), location.function_name()));
 }
 
-bool __LOG(bool condition, string message) {
-	if constexpr (LOG)
-		if (condition)
-			__PRINT(message + "\n");
+////////////////////////////////
+
+namespace Log {
+
+// message waiting in ring buffer
+typedef struct Entry {
+	string text;
+	bool print; // printed to stdout, otherwise logged to log file if open
+} Entry;
+
+// sink, guarded by lock
+static std::mutex lock;
+static std::condition_variable ready; // messages waiting, or closing
+static std::condition_variable space; // buffer no longer full
+static Entry buffer[BUFFER_SIZE];
+static size_t head = 0; // oldest message
+static size_t count = 0;
+static size_t dropped = 0; // log messages dropped since last write
+static bool running = false;
+
+static std::thread sink;
+static std::ofstream file; // only used by sink thread while running
+
+// write messages until closed
+static void run_sink() {
+	std::vector<Entry> batch;
+
+	while (true) {
+		size_t numDropped;
+
+		{
+			std::unique_lock<std::mutex> guard(lock);
+			ready.wait(guard, [] { return count > 0 || !running; });
+
+			if (count == 0 && !running)
+				break;
+
+			// take all waiting messages, then write without holding lock
+			for (; count > 0; count --) {
+				batch.push_back(std::move(buffer[head]));
+				head = (head + 1) % BUFFER_SIZE;
+			}
+
+			numDropped = dropped;
+			dropped = 0;
+		}
+
+		space.notify_all();
+
+		std::ostream& logOut = file.is_open() ? (std::ostream&) file : std::cout;
+
+		for (Entry& e : batch)
+			(e.print ? std::cout : logOut) << e.text;
+
+		if (numDropped > 0)
+			logOut << format("[{} log messages dropped]\n", numDropped);
+
+		std::cout.flush();
+		logOut.flush();
 
-	return condition;
+		batch.clear();
+	}
 }
 
-void __LOG_VERBOSE(string message) {
-	if constexpr (LOG && LOG_VERBOSE)
-		__PRINT(message + "\n");
+// get settings from .ini, and start sink
+void settings(CSimpleIniA* config) {
+	level = (int) config->GetLongValue("LOG", "level", level);
+
+	open(config->GetValue("LOG", "file", ""));
 }
 
-bool __LOG_VERBOSE(bool condition, string message) {
-	if constexpr (LOG && LOG_VERBOSE)
-		if (condition)
-			__PRINT(message + "\n");
+// start sink thread
+// filename: log file, or empty to log to stdout
+void open(string filename) {
+	close();
+
+	if (!filename.empty()) {
+		file.open(filename, std::ios::app);
+
+		if (!file)
+			throw Exception("Could not write " + filename);
+	}
 
-	return condition;
+	running = true;
+	sink = std::thread(run_sink);
 }
 
-void Exception::print() {
-	__PRINT(format("ERROR: {}\n{}({}:{}) in {}\n", message, location.file_name(), location.line(), location.column(), location.function_name()));
+// write remaining messages and stop sink thread
+void close() {
+	if (!sink.joinable())
+		return;
+
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		running = false;
+	}
+
+	ready.notify_all();
+	sink.join();
+
+	if (file.is_open())
+		file.close();
+}
+
+// hand message to sink, or write it directly if sink is not running
+// print: message is printed to stdout. waits if buffer is full, where a log message would be dropped
+void write(string message, bool print) {
+	{
+		std::unique_lock<std::mutex> guard(lock);
+
+		if (running) {
+			if (count == BUFFER_SIZE) {
+				if (!print) {
+					dropped ++;
+					return;
+				}
+
+				space.wait(guard, [] { return count < BUFFER_SIZE || !running; });
+			}
+
+			if (running) {
+				buffer[(head + count) % BUFFER_SIZE] = { std::move(message), print };
+				count ++;
+
+				guard.unlock();
+				ready.notify_one();
+
+				return;
+			}
+		}
+	}
+
+	std::cout << message;
 }
 
+} // end namespace Log
+
 } // end namespace Bbot2
@@ -1,21 +1,58 @@
 // log.h
 
-// log and log verbose functions
-// Exception class
+// log and log verbose, print, and the Exception class
 // switches are in common.h
 
+// __LOG and __LOG_VERBOSE are macros, so neither their message nor its arguments are evaluated unless their level is on
+// a message is a string, or a std::format string followed by its arguments, e.g.
+//   __LOG("   DEPTH {} (EVAL {})", searchDepth, search_eval());
+// levels compiled in by LOG and LOG_VERBOSE are printed up to Log::level, set at runtime from .ini [LOG]
+
+// once Log::open is called, messages are handed to a ring buffer and written by a sink thread,
+// so threads logging never wait on stdout or a log file. log messages are dropped if the buffer is full, printed ones are not
+// before open and after close, messages are written directly
+
 #pragma once
 
 #include "common.h"
 #include <source_location>
+#include <atomic>
 
 namespace Bbot2 {
 
+enum LogLevel : int { LOG_LEVEL_NONE, LOG_LEVEL_INFO, LOG_LEVEL_VERBOSE };
+
+namespace Log {
+	inline const size_t BUFFER_SIZE = 1 << 12; // messages
+	inline std::atomic<int> level = LOG_LEVEL_NONE;
+
+	// true if messages of level l are printed
+	inline bool enabled(LogLevel l) {
+		return l <= level.load(std::memory_order_relaxed);
+	}
+
+	void settings(CSimpleIniA* config);
+	void open(std::string filename);
+	void close();
+
+	void write(std::string message, bool print);
+
+	// log message, with a line break
+	inline void log(std::string_view message) {
+		write(std::string(message) + "\n", false);
+	}
+
+	template <typename Arg, typename... Args>
+	void log(std::format_string<Arg, Args...> fmt, Arg&& arg, Args&&... args) {
+		write(std::format(fmt, std::forward<Arg>(arg), std::forward<Args>(args)...) + "\n", false);
+	}
+
+} // end namespace Log
+
+#define __LOG(...) do { if constexpr (LOG) if (Log::enabled(LOG_LEVEL_INFO)) Log::log(__VA_ARGS__); } while (false)
+#define __LOG_VERBOSE(...) do { if constexpr (LOG && LOG_VERBOSE) if (Log::enabled(LOG_LEVEL_VERBOSE)) Log::log(__VA_ARGS__); } while (false)
+
 void __PRINT(std::string message);
-void __LOG(std::string message);
-bool __LOG(bool condition, std::string message);
-void __LOG_VERBOSE(std::string message);
-bool __LOG_VERBOSE(bool condition, std::string message);
 
 class Exception : public std::exception {
 public:
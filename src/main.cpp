@@ -7,24 +7,31 @@
 #include "gui.h"
 #include "loadini.h"
 #include "log.h"
+#include "engine.h"
+#include "book.h"
+#include "tuner.h"
+#include "tournament.h"
+#include "analysis.h"
+#include "server.h"
+#include "gamedb.h"
+#include "profile.h"
+#include "bench.h"
+#include "solver.h"
+#include <string>
+#include <thread>
+#include <fstream>
+#include <iostream>
+#include <memory>
 
 namespace Bbot2 {
 
-void play() {
-
-	try {
-
-
-
-	// initialize
+// initialization shared by all modes
+void init(CSimpleIniA* ini) {
 
 	// .ini
-	load_INI();
-	__LOG_VERBOSE(INI_FILE + " loaded");
-
-	// if side is computer
-	bool S_CP1 = std::string(ini.GetValue("GAME", "white-is")) == "computer";
-	bool S_CP2 = std::string(ini.GetValue("GAME", "black-is")) == "computer";
+	load_INI(ini);
+	Log::settings(ini);
+	__LOG_VERBOSE("{} loaded", INI_FILE);
 
 	// bitboard
 	Bitboard::init();
@@ -33,36 +40,49 @@ void play() {
 	// move-gen
 	Tables::init();
 	__LOG_VERBOSE("Move-gen tables generated");
+}
+
+void play() {
+
+	try {
+
+
+
+	// initialize
+	CSimpleIniA ini;
+	init(&ini);
+
+	// player of each side: user, computer (alphabeta), or mcts
+	std::string players[NUM_SIDES] = { ini.GetValue("GAME", "white-is", "user"), ini.GetValue("GAME", "black-is", "user") };
 
 	// board
 	Board board;
-	board.settings();
+	board.settings(&ini);
 	board.init();
 	__LOG_VERBOSE("Board initialized");
 
 	// game
 	Game game(&board);
-	game.settings();
+	game.settings(&ini);
 	game.init();
 
 	// add computers
-	Bbot comp[NUM_SIDES] = { Bbot(&game), Bbot(&game) };
+	Engine* comp[NUM_SIDES] = { nullptr, nullptr };
 
-	if (S_CP1) { // white computer
-		comp[WHITE].init();
-		game.add_player(&comp[WHITE], WHITE);
-		__LOG_VERBOSE("CP1 initialized");
-	}
+	for (Side side : SIDES) {
+		if (players[side] == "user")
+			continue;
 
-	if (S_CP2) { // black computer
-		comp[BLACK].init();
-		game.add_player(&comp[BLACK], BLACK);
-		__LOG_VERBOSE("CP2 initialized");
+		comp[side] = create_engine(players[side] == "computer" ? "alphabeta" : players[side], &game);
+		comp[side]->settings(&ini);
+		comp[side]->init();
+		game.add_player(comp[side], side);
+		__LOG_VERBOSE("CP{} initialized", side + 1);
 	}
 
 	// GUI
 	GUI graphics(&game);
-	graphics.settings(); // from .ini
+	graphics.settings(&ini); // from .ini
 	graphics.init();
 	__LOG_VERBOSE("GUI initialized");
 	__LOG_VERBOSE("\n");
@@ -70,6 +90,7 @@ void play() {
 
 
 	// main loop
+	// graphics waits for events while no search is running, and only draws when something shown has changed
 	while (!graphics.loop_end()) {
 		game.update();
 		graphics.update();
@@ -84,24 +105,433 @@ void play() {
 	graphics.close();
 
 	// computers
-	if (S_CP1) {
-		comp[WHITE].close();
-		__LOG_VERBOSE("CP1 closed");
-	}
+	for (Side side : SIDES) {
+		if (comp[side] == nullptr)
+			continue;
 
-	if (S_CP2) {
-		comp[BLACK].close();
-		__LOG_VERBOSE("CP2 closed");
+		comp[side]->close();
+		delete comp[side];
+		__LOG_VERBOSE("CP{} closed", side + 1);
 	}
 
 	// board
 	board.close();
 	__LOG_VERBOSE("Board closed");
 
-	// move-gen
-	Tables::close();
-	__LOG_VERBOSE("Move-gen tables deallocated");
 
+	} catch (Exception e) {
+		e.print();
+	}
+}
+
+// thread count used by tools if none is given
+int default_threads() {
+	return (std::max)(1, (int) std::thread::hardware_concurrency());
+}
+
+// build opening book from start position in .ini
+// usage: build-book <file> <plies> <depth-limit> <time-limit (ms)> [threads]
+void build_book(int argc, char* args[]) {
+
+	try {
+
+	if (argc < 6)
+		throw Exception("Usage: build-book <file> <plies> <depth-limit> <time-limit> [threads]");
+
+	CSimpleIniA ini;
+	init(&ini);
+
+	std::string filename = args[2];
+	int plies = std::stoi(args[3]);
+	int maxDepth = std::stoi(args[4]);
+	int maxTime = std::stoi(args[5]);
+	int numThreads = argc > 6 ? std::stoi(args[6]) : default_threads();
+
+	Book::build(filename, &ini, plies, maxTime, maxDepth, numThreads);
+
+	} catch (Exception e) {
+		e.print();
+	} catch (std::logic_error e) { // from std::stoi
+		Exception("Invalid argument to build-book").print();
+	}
+}
+
+// generate tuning positions from self-play
+// usage: tune-gen <file> <games> <depth-limit> [threads]
+void tune_gen(int argc, char* args[]) {
+
+	try {
+
+	if (argc < 5)
+		throw Exception("Usage: tune-gen <file> <games> <depth-limit> [threads]");
+
+	CSimpleIniA ini;
+	init(&ini);
+
+	int numThreads = argc > 5 ? std::stoi(args[5]) : default_threads();
+
+	Tuner::generate(args[2], &ini, std::stoi(args[3]), std::stoi(args[4]), numThreads);
+
+	} catch (Exception e) {
+		e.print();
+	} catch (std::logic_error e) { // from std::stoi
+		Exception("Invalid argument to tune-gen").print();
+	}
+}
+
+// tune evaluation parameters on positions from tune-gen
+// usage: tune <file> [iterations] [threads]
+void tune(int argc, char* args[]) {
+
+	try {
+
+	if (argc < 3)
+		throw Exception("Usage: tune <file> [iterations] [threads]");
+
+	CSimpleIniA ini;
+	init(&ini);
+
+	int iterations = argc > 3 ? std::stoi(args[3]) : 1000;
+	int numThreads = argc > 4 ? std::stoi(args[4]) : default_threads();
+
+	Tuner tuner(&ini, numThreads);
+	tuner.load(args[2]);
+	tuner.fit(iterations);
+	tuner.print();
+
+	} catch (Exception e) {
+		e.print();
+	} catch (std::logic_error e) { // from std::stoi
+		Exception("Invalid argument to tune").print();
+	}
+}
+
+// train evaluation network on positions from tune-gen
+// usage: nnue-train <file> <network-file> [epochs] [threads]
+void nnue_train(int argc, char* args[]) {
+
+	try {
+
+	if (argc < 4)
+		throw Exception("Usage: nnue-train <file> <network-file> [epochs] [threads]");
+
+	CSimpleIniA ini;
+	init(&ini);
+
+	int epochs = argc > 4 ? std::stoi(args[4]) : 10;
+	int numThreads = argc > 5 ? std::stoi(args[5]) : default_threads();
+
+	NnueTrainer trainer(numThreads, std::random_device()());
+	trainer.load(args[2]);
+	trainer.train(epochs);
+	trainer.save(args[3]);
+
+	} catch (Exception e) {
+		e.print();
+	} catch (std::logic_error e) { // from std::stoi
+		Exception("Invalid argument to nnue-train").print();
+	}
+}
+
+// play engine-vs-engine match
+// usage: tournament <engine-a.ini> <engine-b.ini> <games> [threads] [openings]
+void tournament(int argc, char* args[]) {
+
+	try {
+
+	if (argc < 5)
+		throw Exception("Usage: tournament <engine-a.ini> <engine-b.ini> <games> [threads] [openings]");
+
+	CSimpleIniA ini;
+	init(&ini);
+
+	int numGames = std::stoi(args[4]);
+	int numThreads = argc > 5 ? std::stoi(args[5]) : default_threads();
+
+	Tournament match;
+	match.settings(&ini);
+	match.load_engine(0, args[2]);
+	match.load_engine(1, args[3]);
+
+	if (argc > 6)
+		match.load_openings(args[6]);
+
+	match.run(numGames, numThreads);
+	match.print();
+
+	} catch (Exception e) {
+		e.print();
+	} catch (std::logic_error e) { // from std::stoi
+		Exception("Invalid argument to tournament").print();
+	}
+}
+
+// analyse a file of positions, with limits and engine settings from .ini
+// usage: analyze <positions> <output|-> [threads] [--shared-tt] [--stats] [--multipv <lines>]
+void analyze(int argc, char* args[]) {
+
+	try {
+
+	if (argc < 4)
+		throw Exception("Usage: analyze <positions> <output|-> [threads] [--shared-tt] [--stats] [--multipv <lines>]");
+
+	CSimpleIniA ini;
+	init(&ini);
+
+	int numThreads = default_threads();
+	bool shareTT = false;
+	bool withStats = false;
+	int multiPV = 0; // from .ini if not given
+
+	for (int i = 4; i < argc; i ++) {
+		if (std::string(args[i]) == "--shared-tt") {
+			shareTT = true;
+		} else if (std::string(args[i]) == "--stats") {
+			withStats = true;
+		} else if (std::string(args[i]) == "--multipv" && i + 1 < argc) {
+			multiPV = std::stoi(args[++ i]);
+		} else {
+			numThreads = std::stoi(args[i]);
+		}
+	}
+
+	Analysis analysis;
+	analysis.settings(&ini);
+	analysis.withStats = withStats;
+
+	if (multiPV > 0)
+		analysis.multiPV = multiPV;
+	analysis.load(args[2]);
+
+	// '-' writes results to stdout
+	std::string filename = args[3];
+	std::ofstream file;
+
+	if (filename != "-") {
+		file.open(filename, std::ios::trunc);
+
+		if (!file)
+			throw Exception("Could not write " + filename);
+	}
+
+	analysis.run(filename == "-" ? &std::cout : &file, numThreads, shareTT);
+
+	} catch (Exception e) {
+		e.print();
+	} catch (std::logic_error e) { // from std::stoi
+		Exception("Invalid argument to analyze").print();
+	}
+}
+
+// serve analysis requests to local clients, with limits and engine settings from .ini
+// usage: serve <socket-path|port> [threads] [--shared-tt]
+void serve(int argc, char* args[]) {
+
+	try {
+
+	if (argc < 3)
+		throw Exception("Usage: serve <socket-path|port> [threads] [--shared-tt] [--allow-quit]");
+
+	CSimpleIniA ini;
+	init(&ini);
+
+	int numThreads = default_threads();
+	bool shareTT = false;
+
+	// shared with console thread, which may outlive this function
+	std::shared_ptr<Server> server = std::make_shared<Server>();
+	server->settings(&ini);
+
+	for (int i = 3; i < argc; i ++) {
+		if (std::string(args[i]) == "--shared-tt") {
+			shareTT = true;
+		} else if (std::string(args[i]) == "--allow-quit") {
+			server->allowClientQuit = true;
+		} else {
+			numThreads = std::stoi(args[i]);
+		}
+	}
+
+	server->open(args[2]);
+
+	// typing quit on the console stops the server
+	std::thread([server] {
+		std::string line;
+
+		while (std::getline(std::cin, line)) {
+			if (line == "quit") {
+				server->stop();
+				return;
+			}
+		}
+	}).detach();
+
+	server->run(numThreads, shareTT);
+	server->close();
+
+	} catch (Exception e) {
+		e.print();
+	} catch (std::logic_error e) { // from std::stoi
+		Exception("Invalid argument to serve").print();
+	}
+}
+
+// build position index of a games file, see gamedb.h
+// usage: index-games <games-file>
+void index_games(int argc, char* args[]) {
+
+	try {
+
+	if (argc < 3)
+		throw Exception("Usage: index-games <games-file>");
+
+	CSimpleIniA ini;
+	init(&ini);
+
+	GameIndex::build(args[2]);
+
+	} catch (Exception e) {
+		e.print();
+	}
+}
+
+// list every game of an indexed games file through a position, with its moves from there
+// usage: find-games <games-file> <position in compact notation>
+void find_games(int argc, char* args[]) {
+
+	try {
+
+	if (argc < 4)
+		throw Exception("Usage: find-games <games-file> <position>");
+
+	CSimpleIniA ini;
+	init(&ini);
+
+	// compact notation has spaces, so may be split over arguments
+	std::string position = args[3];
+	for (int i = 4; i < argc; i ++)
+		position += " " + std::string(args[i]);
+
+	Board board;
+	board.from_compact(position);
+
+	GameIndex index;
+	if (!index.open(args[2]))
+		throw Exception("No index of " + std::string(args[2]) + ", run index-games first");
+
+	std::vector<GameIndexEntry> found = index.find(GameIndex::key_of(&board));
+
+	GameReader reader;
+	reader.open(args[2]);
+
+	const std::string OUTCOMES[] = { "*", "1-0", "0-1", "1/2 (repetition)", "1/2 (move limit)" };
+
+	for (GameIndexEntry& e : found) {
+		if (!reader.read_at(index.offset_of(e.game)))
+			throw Exception(std::format("Games file does not match its index at game {}", e.game));
+
+		// continuation from position
+		LineVector line;
+		for (int i = e.ply; i < reader.record.numMoves; i ++)
+			line.append(reader.moves[i]);
+
+		reader.replay(&board, e.ply);
+
+		__PRINT(std::format("game {} ply {} {}: {}\n", e.game, e.ply, OUTCOMES[reader.record.outcome],
+			line.to_string(e.ply + reader.record.sideToMove, board.pointerBoard)));
+	}
+
+	__PRINT(std::format("{} of {} games\n", found.size(), index.games()));
+
+	reader.close();
+	index.close();
+	board.close();
+
+	} catch (Exception e) {
+		e.print();
+	}
+}
+
+// time hot paths of board and engine, over positions of a file or random positions
+// usage: bench [samples] [positions]
+void bench(int argc, char* args[]) {
+
+	try {
+
+	CSimpleIniA ini;
+	init(&ini);
+
+	Bench bench;
+	bench.settings(&ini);
+
+	if (argc > 2)
+		bench.SAMPLES = std::stoi(args[2]);
+
+	if (argc > 3)
+		bench.load(args[3]);
+
+	bench.run();
+	bench.print();
+
+	} catch (Exception e) {
+		e.print();
+	} catch (std::logic_error e) { // from std::stoi
+		Exception("Invalid argument to bench").print();
+	}
+}
+
+// prove or disprove a forced win for the side to move, with limits from .ini, see solver.h
+// usage: solve <position in compact notation>
+void solve(int argc, char* args[]) {
+
+	try {
+
+	if (argc < 3)
+		throw Exception("Usage: solve <position>");
+
+	CSimpleIniA ini;
+	init(&ini);
+
+	// compact notation has spaces, so may be split over arguments
+	std::string position = args[2];
+	for (int i = 3; i < argc; i ++)
+		position += " " + std::string(args[i]);
+
+	Board board;
+	board.from_compact(position);
+
+	Solver solver(&board);
+	solver.settings(&ini);
+	solver.init();
+
+	Solution solution = solver.solve();
+
+	if (solution.result == SOLVE_WIN) {
+		__PRINT(std::format("{} wins in {} plies: {}\n", SIDE_NAMES[board.sideToMove], solution.line.length,
+			solution.line.to_string(board.ply, board.pointerBoard)));
+	} else if (solution.result == SOLVE_NO_WIN) {
+		__PRINT(std::format("{} has no forcing win\n", SIDE_NAMES[board.sideToMove]));
+	} else {
+		__PRINT("Unknown, search limit reached\n");
+	}
+
+	__PRINT(std::format("{} nodes in {:.3f}s\n", solution.nodes, solution.time));
+
+	solver.close();
+	board.close();
+
+	} catch (Exception e) {
+		e.print();
+	}
+}
+
+// print profile of every thread, and write its trace, see profile.h
+void profile() {
+
+	try {
+
+	Profiler::print();
+	Profiler::write_trace(PROFILE_TRACE_FILE);
 
 	} catch (Exception e) {
 		e.print();
@@ -111,7 +541,38 @@ void play() {
 } // end namespace Bbot2
 
 int main(int argc, char* args[]) {
-	Bbot2::play();
+	std::string mode = argc > 1 ? args[1] : "";
+
+	if (mode == "build-book") {
+		Bbot2::build_book(argc, args);
+	} else if (mode == "tune-gen") {
+		Bbot2::tune_gen(argc, args);
+	} else if (mode == "tune") {
+		Bbot2::tune(argc, args);
+	} else if (mode == "nnue-train") {
+		Bbot2::nnue_train(argc, args);
+	} else if (mode == "tournament") {
+		Bbot2::tournament(argc, args);
+	} else if (mode == "analyze") {
+		Bbot2::analyze(argc, args);
+	} else if (mode == "serve") {
+		Bbot2::serve(argc, args);
+	} else if (mode == "index-games") {
+		Bbot2::index_games(argc, args);
+	} else if (mode == "find-games") {
+		Bbot2::find_games(argc, args);
+	} else if (mode == "bench") {
+		Bbot2::bench(argc, args);
+	} else if (mode == "solve") {
+		Bbot2::solve(argc, args);
+	} else {
+		Bbot2::play();
+	}
+
+	if constexpr (Bbot2::PROFILE)
+		Bbot2::profile();
+
+	Bbot2::Log::close();
 
 	return 0;
 }
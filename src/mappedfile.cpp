@@ -0,0 +1,123 @@
+// mappedfile.cpp
+
+#include "mappedfile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using std::string;
+
+namespace Bbot2 {
+
+// MappedFile //
+
+// map file into memory
+// returns false if file is missing or empty
+bool MappedFile::open(string filename) {
+	close();
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	fileHandle = file;
+
+	LARGE_INTEGER size;
+
+	if (!GetFileSizeEx(file, &size)) {
+		close();
+		return false;
+	}
+
+	viewSize = static_cast<size_t>(size.QuadPart);
+
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+
+	if (mapping == NULL) {
+		close();
+		return false;
+	}
+
+	mappingHandle = mapping;
+	view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+#else
+	fd = ::open(filename.c_str(), O_RDONLY);
+
+	if (fd < 0)
+		return false;
+
+	struct stat st;
+
+	if (fstat(fd, &st) != 0) {
+		close();
+		return false;
+	}
+
+	viewSize = static_cast<size_t>(st.st_size);
+
+	void* p = viewSize > 0 ? mmap(nullptr, viewSize, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+	view = p == MAP_FAILED ? nullptr : p;
+#endif
+
+	if (view == nullptr) {
+		close();
+		return false;
+	}
+
+	return true;
+}
+
+// true if a file is mapped
+bool MappedFile::is_open() {
+	return view != nullptr;
+}
+
+// unmap file
+void MappedFile::close() {
+#ifdef _WIN32
+	if (view != nullptr)
+		UnmapViewOfFile(view);
+
+	if (mappingHandle != nullptr)
+		CloseHandle(mappingHandle);
+
+	if (fileHandle != nullptr)
+		CloseHandle(fileHandle);
+
+	fileHandle = nullptr;
+	mappingHandle = nullptr;
+#else
+	if (view != nullptr)
+		munmap(const_cast<void*>(view), viewSize);
+
+	if (fd >= 0)
+		::close(fd);
+
+	fd = -1;
+#endif
+
+	view = nullptr;
+	viewSize = 0;
+}
+
+// start of mapped file, nullptr if none
+const void* MappedFile::data() {
+	return view;
+}
+
+// size of mapped file in bytes
+size_t MappedFile::size() {
+	return viewSize;
+}
+
+} // end namespace Bbot2
@@ -0,0 +1,28 @@
+// mappedfile.h
+
+// read-only memory-mapped file
+// used for sorted files that are binary searched in place, see Book and GameIndex
+
+#pragma once
+
+#include "common.h"
+
+namespace Bbot2 {
+
+class MappedFile {
+	const void* view = nullptr;
+	size_t viewSize = 0;
+	void* fileHandle = nullptr; // windows only
+	void* mappingHandle = nullptr; // windows only
+	int fd = -1; // posix only
+
+public:
+	bool open(std::string filename);
+	bool is_open();
+	void close();
+
+	const void* data();
+	size_t size();
+};
+
+} // end namespace Bbot2
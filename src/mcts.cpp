@@ -0,0 +1,544 @@
+// mcts.cpp
+
+#include "mcts.h"
+#include <cmath>
+
+using std::string;
+using std::vector;
+using std::format;
+
+namespace Bbot2 {
+
+// Mcts //
+
+// constructor
+Mcts::Mcts(Game* game_)
+	: game(game_), board(game_->board) {}
+
+// get settings from .ini
+// config is kept for the evaluation parameters of playouts, so must outlive engine
+void Mcts::settings(CSimpleIniA* config_) {
+	config = config_;
+
+	NUM_THREADS = (int) config->GetLongValue("MCTS", "threads", NUM_THREADS);
+	NODE_ALLOC = (u_long) config->GetLongValue("MCTS", "node-allocation", NODE_ALLOC);
+	SELECTION = string(config->GetValue("MCTS", "selection", "puct")) == "uct" ? SELECTION_UCT : SELECTION_PUCT;
+	EXPLORATION = (float) config->GetDoubleValue("MCTS", "exploration", EXPLORATION);
+	EVAL_PLAYOUTS = string(config->GetValue("MCTS", "playouts", EVAL_PLAYOUTS ? "eval" : "random")) == "eval";
+	PLAYOUT_PLIES = (int) config->GetLongValue("MCTS", "playout-plies", PLAYOUT_PLIES);
+	VIRTUAL_LOSS = (int) config->GetLongValue("MCTS", "virtual-loss", VIRTUAL_LOSS);
+}
+
+// init
+void Mcts::init() {
+	if (!game->initialized)
+		game->init();
+
+	if (NUM_THREADS <= 0)
+		NUM_THREADS = (std::max)(1, (int) std::thread::hardware_concurrency());
+
+	// root and its children at least
+	NODE_ALLOC = (std::max)(NODE_ALLOC, (u_long) NUM_SQUARES * NUM_PIECES);
+	nodes = new MctsNode[NODE_ALLOC];
+
+	initialized = true;
+}
+
+// attach new game and reset what is necessary
+void Mcts::attach_game(Game* game_) {
+	game = game_;
+	board = game->board;
+
+	PV.length = 0;
+	winRate = 0.5f;
+	wonFound = false;
+}
+
+// tree is not kept between searches, so there is nothing of the game to release
+void Mcts::release_game() {}
+
+////
+
+// search until maxTime (ms), waiting at most REPORT_MS per call
+// returns true while searching, false when done
+bool Mcts::search(int maxTime, int maxDepth) {
+
+	// if not searching, start workers
+	if (!searching) {
+		startClock = std::chrono::steady_clock::now();
+		allottedTime = maxTime;
+		rootSide = SIDES[board->sideToMove];
+
+		// a win needs no search
+		Move move;
+		bool won = board->find_winning_move(&move);
+		board->update_move_sets();
+
+		if (won) {
+			bestMove = move;
+			PV.length = 0;
+			PV.append(move);
+			winRate = 1;
+			wonFound = true;
+			return false;
+		}
+
+		start();
+		searching = true;
+
+		__LOG("[{}]: SEARCHING...", SIDE_NAMES[board->sideToMove]);
+	}
+
+	long long remaining = allottedTime - search_clock();
+	if (remaining > 0)
+		std::this_thread::sleep_for(std::chrono::milliseconds((std::min)(remaining, (long long) REPORT_MS)));
+
+	update_results();
+
+	// a single legal move is played without searching further
+	if (search_clock() < allottedTime && nodes[0].numChildren > 1)
+		return true;
+
+	stop();
+	update_results();
+	searching = false;
+
+	__LOG("   {} PLAYOUTS (EVAL {}): {} ({} ms)", playouts.load(), search_eval(), search_PV(), searchDuration * 1000);
+
+	return false;
+}
+
+// end search on next call
+void Mcts::search_abort() {
+	allottedTime = 0;
+}
+
+// tree is rebuilt for every search, so only the PV is out of date
+void Mcts::on_move_played(Move move) {
+	PV.length = 0;
+}
+
+////
+
+// get final evaluation of most recent search
+// as a score, or as a win of the side to move if its best move takes the last watering hole
+string Mcts::search_eval() {
+	if (wonFound)
+		return rootSide == WHITE ? "+M1" : "-M1";
+
+	return format("{:+.3f}", search_score());
+}
+
+// get PV string
+string Mcts::search_PV() {
+	return board->line_to_string(PV);
+}
+
+// true while searching
+bool Mcts::search_ongoing() {
+	return searching;
+}
+
+// get depth of deepest path in tree
+int Mcts::search_depth() {
+	return treeDepth.load(std::memory_order_relaxed);
+}
+
+// get win rate of best move as a score, positive if favouring white
+// the logit of the win rate, which is the evaluation of eval-guided playouts in watering holes, see EVAL_SCALE
+float Mcts::search_score() {
+	if (wonFound)
+		return rootSide == WHITE ? INFINITY : -INFINITY;
+
+	float p = std::clamp(winRate, 0.001f, 0.999f);
+	float score = std::log(p / (1 - p));
+
+	return rootSide == WHITE ? score : -score;
+}
+
+// get time taken by most recent search
+double Mcts::search_duration() {
+	return searchDuration;
+}
+
+// get playouts/sec
+int Mcts::search_speed() {
+	if (searchDuration > 0) {
+		return (int) ((double) playouts.load() / searchDuration);
+	} else {
+		return 0;
+	}
+}
+
+// speed is counted in playouts
+string Mcts::search_speed_unit() {
+	return "playouts";
+}
+
+// get playouts of most recent search
+unsigned __int64 Mcts::search_playouts() {
+	return playouts.load();
+}
+
+// get most visited move of root
+Move Mcts::suggested_move() {
+	return bestMove;
+}
+
+////
+
+// stop any search
+void Mcts::soft_close() {
+	stop();
+	searching = false;
+}
+
+// close
+// stop any search and de-allocate node pool
+void Mcts::close() {
+	if (!initialized)
+		return;
+
+	soft_close();
+
+	delete[] nodes;
+	nodes = nullptr;
+
+	initialized = false;
+}
+
+////////////////////////////////
+
+// build root of tree from board, and start workers
+void Mcts::start() {
+	rootPosition = board->to_compact();
+
+	playouts = 0;
+	treeDepth = 0;
+	stopping = false;
+
+	nodesUsed = 1;
+	reset_node(&nodes[0], Move(), 1);
+	expand(&nodes[0], board);
+
+	wonFound = false;
+	winRate = 0.5f;
+	PV.length = 0;
+
+	// until a child of root is visited, e.g. if aborted at once, the first legal move is suggested
+	// none if root has no legal moves. never the result of a previous search
+	bestMove = Move();
+
+	for (Piece* p : board->pieces[board->sideToMove]) {
+		u_long scalar;
+
+		if (Bitboard::scan_forward(&scalar, &p->moveBoard)) {
+			bestMove = Move(p->scalar, (u_short) scalar);
+			break;
+		}
+	}
+
+	for (int i = 0; i < NUM_THREADS; i ++)
+		workers.push_back(std::thread(&Mcts::worker, this, (unsigned int) (board->ply * NUM_THREADS + i + 1)));
+}
+
+// stop and join workers
+void Mcts::stop() {
+	stopping = true;
+
+	for (std::thread& t : workers)
+		t.join();
+
+	workers.clear();
+	searchDuration = (double) search_clock() / 1000;
+}
+
+// read best move, its win rate, and PV from tree
+// may be called while workers are running. if no child of root is visited yet, the move set by start is kept
+void Mcts::update_results() {
+	MctsNode* node = best_child(&nodes[0]);
+
+	if (node == nullptr)
+		return;
+
+	bestMove = node->move;
+
+	int visits = node->visits.load(std::memory_order_relaxed);
+	winRate = visits > 0 ? node->value.load(std::memory_order_relaxed) / visits : 0.5f;
+	wonFound = node->won.load(std::memory_order_relaxed);
+
+	// follow most visited moves
+	PV.length = 0;
+
+	while (node != nullptr && PV.length < MAX_LINE_LEN) {
+		PV.append(node->move);
+		node = best_child(node);
+	}
+
+	searchDuration = (double) search_clock() / 1000;
+}
+
+////
+
+// run simulations on own copy of root position until stopped
+void Mcts::worker(unsigned int seed) {
+	try {
+
+	Board position;
+	position.from_compact(rootPosition);
+
+	Game positionGame(&position);
+	positionGame.init();
+
+	// evaluators only use their value tables, so are not initialized, see Tuner
+	Bbot evaluator(&positionGame);
+	if (config != nullptr)
+		evaluator.settings(config);
+	evaluator.init_eval_boards();
+
+	std::mt19937 rng(seed);
+
+	while (!stopping.load(std::memory_order_relaxed))
+		simulate(&position, &positionGame, &evaluator, rng);
+
+	positionGame.close();
+	position.close();
+
+	} catch (Exception e) {
+		e.print();
+	}
+}
+
+// one simulation: select a path from root, expand its leaf, play out from one of the leaf's children, and back up the result
+// position is returned to root afterwards
+void Mcts::simulate(Board* position, Game* positionGame, Bbot* evaluator, std::mt19937& rng) {
+	vector<MctsNode*> path = { &nodes[0] };
+	MctsNode* node = &nodes[0];
+	bool expanded = false;
+
+	while (!node->won.load(std::memory_order_relaxed)) {
+
+		// expand one leaf per simulation. if another worker is expanding it, play out from it instead
+		if (!expanded && node->state.load(std::memory_order_acquire) == NODE_LEAF)
+			expanded = expand(node, position);
+
+		if (node->state.load(std::memory_order_acquire) != NODE_EXPANDED || node->numChildren == 0)
+			break;
+
+		MctsNode* child = select(node);
+		child->visits.fetch_add(VIRTUAL_LOSS, std::memory_order_relaxed);
+
+		position->move_piece(position->pointerBoard[child->move.get_from()], child->move.get_to());
+
+		if (positionGame->game_lost())
+			child->won.store(true, std::memory_order_relaxed);
+
+		path.push_back(child);
+		node = child;
+
+		if (expanded)
+			break;
+	}
+
+	// result for white
+	float result;
+
+	if (node->won.load(std::memory_order_relaxed)) {
+		result = SIDES[!position->sideToMove] == WHITE ? 1.0f : 0.0f;
+	} else {
+		result = playout(position, positionGame, evaluator, rng);
+	}
+
+	// back up, removing virtual losses. nodes at odd depths are moves of root side
+	nodes[0].visits.fetch_add(1, std::memory_order_relaxed);
+
+	for (size_t i = 1; i < path.size(); i ++) {
+		Side mover = (i % 2 == 1) ? rootSide : SIDES[!rootSide];
+
+		path[i]->value.fetch_add(mover == WHITE ? result : 1 - result, std::memory_order_relaxed);
+		path[i]->visits.fetch_add(1 - VIRTUAL_LOSS, std::memory_order_relaxed);
+	}
+
+	// back to root
+	for (size_t i = path.size() - 1; i >= 1; i --)
+		position->move_piece(position->pointerBoard[path[i]->move.get_to()], path[i]->move.get_from());
+
+	int depth = (int) path.size() - 1;
+	int deepest = treeDepth.load(std::memory_order_relaxed);
+	while (depth > deepest && !treeDepth.compare_exchange_weak(deepest, depth, std::memory_order_relaxed));
+
+	playouts.fetch_add(1, std::memory_order_relaxed);
+}
+
+// add children of node for every legal move of position
+// returns false if node was taken by another worker, or the pool is used up
+bool Mcts::expand(MctsNode* node, Board* position) {
+	if (nodesUsed.load(std::memory_order_relaxed) >= NODE_ALLOC)
+		return false;
+
+	MctsNodeState expected = NODE_LEAF;
+	if (!node->state.compare_exchange_strong(expected, NODE_EXPANDING, std::memory_order_acq_rel))
+		return false;
+
+	position->update_move_sets();
+
+	Move moves[NUM_SQUARES * PIECES_PER_SIDE];
+	float weights[NUM_SQUARES * PIECES_PER_SIDE];
+	int n = 0;
+	float total = 0;
+
+	for (Piece* p : position->pieces[position->sideToMove]) {
+		bboard moveBoard = p->moveBoard;
+		u_long scalar;
+
+		while (Bitboard::scan_forward(&scalar, &moveBoard)) {
+			moveBoard ^= Bitboard::SQUARES[scalar];
+
+			moves[n] = Move(p->scalar, (u_short) scalar);
+			weights[n] = position->wateringHoles[scalar] ? WH_PRIOR : 1;
+			total += weights[n];
+			n ++;
+		}
+	}
+
+	u_long first = nodesUsed.fetch_add(n, std::memory_order_relaxed);
+
+	if (first + n > NODE_ALLOC) {
+		node->state.store(NODE_LEAF, std::memory_order_release);
+		return false;
+	}
+
+	for (int i = 0; i < n; i ++)
+		reset_node(&nodes[first + i], moves[i], weights[i] / total);
+
+	node->firstChild = first;
+	node->numChildren = (u_short) n;
+	node->state.store(NODE_EXPANDED, std::memory_order_release);
+
+	return true;
+}
+
+// child of node to search, by UCT or PUCT
+// visits of children include virtual losses, which lower their win rate while workers pass through
+MctsNode* Mcts::select(MctsNode* node) {
+	MctsNode* children = &nodes[node->firstChild];
+	MctsNode* best = &children[0];
+	float bestScore = -INFINITY;
+
+	int parentVisits = (std::max)(1, node->visits.load(std::memory_order_relaxed));
+	float logN = std::log((float) parentVisits);
+	float sqrtN = std::sqrt((float) parentVisits);
+
+	for (int i = 0; i < node->numChildren; i ++) {
+		MctsNode* c = &children[i];
+		int n = c->visits.load(std::memory_order_relaxed);
+		float q = n > 0 ? c->value.load(std::memory_order_relaxed) / n : 0.5f;
+		float score;
+
+		if (SELECTION == SELECTION_UCT) {
+			// unvisited first, by prior
+			score = n > 0 ? q + EXPLORATION * std::sqrt(logN / n) : 1e9f + c->prior;
+		} else {
+			score = q + EXPLORATION * c->prior * sqrtN / (1 + n);
+		}
+
+		if (score > bestScore) {
+			bestScore = score;
+			best = c;
+		}
+	}
+
+	return best;
+}
+
+// play random moves from position until a side wins, or PLAYOUT_PLIES
+// a side able to take its last watering hole always does
+// returns result for white: 1 for a win, 0 for a loss, 0.5 for no result, or the win chance of the evaluation if EVAL_PLAYOUTS
+float Mcts::playout(Board* position, Game* positionGame, Bbot* evaluator, std::mt19937& rng) {
+	Move played[MAX_PLAYOUT_PLIES];
+	int length = 0;
+	float result = 0.5f;
+	bool decided = false;
+
+	int plies = (std::min)(PLAYOUT_PLIES, MAX_PLAYOUT_PLIES);
+
+	for (; length < plies; length ++) {
+		Move move;
+		position->update_move_sets();
+
+		if (position->find_winning_move(&move)) {
+			result = SIDES[position->sideToMove] == WHITE ? 1.0f : 0.0f;
+			decided = true;
+			break;
+		}
+
+		// no legal move, no result
+		if (!position->random_move(rng, &move)) {
+			decided = true;
+			break;
+		}
+
+		position->move_piece(position->pointerBoard[move.get_from()], move.get_to());
+		played[length] = move;
+
+		if (positionGame->game_lost()) {
+			result = SIDES[!position->sideToMove] == WHITE ? 1.0f : 0.0f;
+			decided = true;
+			length ++;
+			break;
+		}
+	}
+
+	// evaluate is relative to side to move
+	if (!decided && EVAL_PLAYOUTS) {
+		float p = 1 / (1 + std::exp(-(float) evaluator->evaluate() / EVAL_SCALE));
+		result = SIDES[position->sideToMove] == WHITE ? p : 1 - p;
+	}
+
+	for (int i = length - 1; i >= 0; i --)
+		position->move_piece(position->pointerBoard[played[i].get_to()], played[i].get_from());
+
+	return result;
+}
+
+////
+
+// most visited child of node, nullptr if node is not expanded or none is visited
+MctsNode* Mcts::best_child(MctsNode* node) {
+	if (node->state.load(std::memory_order_acquire) != NODE_EXPANDED)
+		return nullptr;
+
+	MctsNode* best = nullptr;
+	int bestVisits = 0;
+
+	for (int i = 0; i < node->numChildren; i ++) {
+		MctsNode* c = &nodes[node->firstChild + i];
+		int visits = c->visits.load(std::memory_order_relaxed);
+
+		if (visits > bestVisits) {
+			bestVisits = visits;
+			best = c;
+		}
+	}
+
+	return best;
+}
+
+// clear node for reuse
+void Mcts::reset_node(MctsNode* node, Move move, float prior) {
+	node->move = move;
+	node->prior = prior;
+	node->visits.store(0, std::memory_order_relaxed);
+	node->value.store(0, std::memory_order_relaxed);
+	node->won.store(false, std::memory_order_relaxed);
+	node->state.store(NODE_LEAF, std::memory_order_relaxed);
+	node->firstChild = 0;
+	node->numChildren = 0;
+}
+
+// ms since search started
+long long Mcts::search_clock() {
+	return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startClock).count();
+}
+
+} // end namespace Bbot2
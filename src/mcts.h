@@ -0,0 +1,147 @@
+// mcts.h
+
+// Monte Carlo tree search engine, an alternative to the alphabeta search of Bbot
+// each simulation selects a path down the tree by UCT or PUCT, expands one node, and plays a playout from it.
+// playouts are random moves, taking a win when one is available, until a side holds its watering holes (Game::game_lost),
+// or until PLAYOUT_PLIES, where the position is scored as a draw, or by Bbot::evaluate if playouts are eval-guided
+
+// tree parallelism: NUM_THREADS workers share one tree, each on its own copy of the position
+// a worker passing through a node adds a virtual loss to it, so other workers spread to other paths until it is backed up
+// nodes are taken from a pool of NODE_ALLOC. once it is used up, the tree stops growing and simulations only add playouts
+
+// value of a node is the sum of results for the side that played its move: 1 for a win, 0 for a loss
+// the tree is rebuilt for every search, and maxDepth is not used. depth reported is the deepest path of the tree
+
+#pragma once
+
+#include "common.h"
+#include "log.h"
+#include "engine.h"
+#include "board.h"
+#include "game.h"
+#include "bbot.h"
+#include <atomic>
+#include <thread>
+#include <random>
+#include <chrono>
+
+namespace Bbot2 {
+
+enum MctsSelection : int { SELECTION_UCT, SELECTION_PUCT };
+enum MctsNodeState : u_byte { NODE_LEAF, NODE_EXPANDING, NODE_EXPANDED };
+
+typedef struct MctsNode {
+	Move move; // move into node
+	float prior = 1; // PUCT prior of move, among its siblings
+
+	std::atomic<int> visits = 0; // including virtual losses of workers passing through
+	std::atomic<float> value = 0; // sum of results for side that played move
+	std::atomic<bool> won = false; // move took the last watering hole
+
+	std::atomic<MctsNodeState> state = NODE_LEAF;
+	u_long firstChild = 0; // index in pool, set before state is NODE_EXPANDED
+	u_short numChildren = 0;
+} MctsNode;
+
+class Mcts : public Engine {
+public:
+	////
+
+	//// SETTINGS ////
+
+	int NUM_THREADS = 0; // 0 for one per hardware thread
+	u_long NODE_ALLOC = 1 << 20;
+
+	MctsSelection SELECTION = SELECTION_PUCT;
+	float EXPLORATION = 1.4f; // UCT or PUCT constant
+	float WH_PRIOR = 4; // PUCT weight of a move onto a watering hole, other moves have 1
+
+	bool EVAL_PLAYOUTS = true; // score positions at the end of playouts by Bbot::evaluate, otherwise as a draw
+	int PLAYOUT_PLIES = 20; // capped by MAX_PLAYOUT_PLIES
+	float EVAL_SCALE = 20000; // evaluation of a 73% win, one watering hole, see Bbot::ON_WH_SCORE
+
+	int VIRTUAL_LOSS = 3; // visits added without value by a worker passing through
+
+	int REPORT_MS = 50; // longest wait within a call of search
+
+	// usually overrided by .ini in settings()
+
+	////
+
+	static constexpr int MAX_PLAYOUT_PLIES = 256;
+
+private:
+	CSimpleIniA* config = nullptr; // evaluation parameters of playouts
+
+	Game* game;
+	Board* board;
+
+	MctsNode* nodes = nullptr; // pool, [0] is root
+	std::atomic<u_long> nodesUsed = 0;
+
+	std::vector<std::thread> workers;
+	std::atomic<bool> stopping = false;
+	std::atomic<long long> allottedTime = 0; // ms
+	std::atomic<unsigned __int64> playouts = 0;
+	std::atomic<int> treeDepth = 0;
+
+	Side rootSide = WHITE;
+	std::string rootPosition; // compact notation, set up by each worker
+
+	bool searching = false;
+	std::chrono::steady_clock::time_point startClock;
+
+	// results of most recent search
+	Move bestMove;
+	Line PV;
+	float winRate = 0.5f; // of best move
+	bool wonFound = false; // best move wins
+	double searchDuration = 0;
+
+public:
+	bool initialized = false;
+
+	Mcts(Game* game_);
+
+	void settings(CSimpleIniA* config_) override;
+	void init() override;
+	void attach_game(Game* game_) override;
+	void release_game() override;
+
+	bool search(int maxTime, int maxDepth) override;
+	void search_abort() override;
+
+	void on_move_played(Move move) override;
+
+	std::string search_eval() override;
+	std::string search_PV() override;
+	bool search_ongoing() override;
+	int search_depth() override;
+	float search_score() override;
+	double search_duration() override;
+	int search_speed() override;
+	std::string search_speed_unit() override;
+	unsigned __int64 search_playouts();
+	Move suggested_move() override;
+
+	void soft_close() override;
+	void close() override;
+
+private:
+	void start();
+	void stop();
+	void update_results();
+
+	void worker(unsigned int seed);
+	void simulate(Board* position, Game* positionGame, Bbot* evaluator, std::mt19937& rng);
+	bool expand(MctsNode* node, Board* position);
+	MctsNode* select(MctsNode* node);
+	float playout(Board* position, Game* positionGame, Bbot* evaluator, std::mt19937& rng);
+
+	MctsNode* best_child(MctsNode* node);
+	void reset_node(MctsNode* node, Move move, float prior);
+
+	long long search_clock();
+};
+
+} // end namespace Bbot2
@@ -23,26 +23,36 @@ Move::Move(u_short from, u_short to) {
 	value = (from << 8) | to;
 }
 
-// construct with string
-Move::Move(string s) {
-	string files(FILE_CHARS);
+// construct with string, e.g. "Ld2c3" or "Mf10f4"
+// piece char is optional. if string is not a move, value is 0
+Move::Move(std::string_view s)
+	: value(0) {
 
-	s = s.substr(1, s.size() - 1); // crop type
+	size_t i = 0;
+	u_short squares[2];
 
-	size_t from = files.find(s[0]); // from col
-	s = s.substr(1, s.size() - 1);
+	// crop type
+	if (i < s.size() && s[i] >= 'A' && s[i] <= 'Z')
+		i ++;
 
-	from += BOARD_SIZE * (std::stoi(s) - 1);  // from row
-	if (std::stoi(s) == BOARD_SIZE)
-		s = s.substr(1, s.size() - 1);
-	s = s.substr(1, s.size() - 1);
+	// from, then to
+	for (int j = 0; j < 2; j ++) {
+		if (i >= s.size() || s[i] < FILE_CHARS[0] || s[i] >= FILE_CHARS[0] + BOARD_SIZE)
+			return;
 
-	size_t to = files.find(s[0]); // to col
-	s = s.substr(1, s.size() - 1);
+		int col = s[i ++] - FILE_CHARS[0];
+		int row = 0;
 
-	to += BOARD_SIZE * (std::stoi(s) - 1);  // from row
+		while (i < s.size() && s[i] >= '0' && s[i] <= '9')
+			row = row * 10 + (s[i ++] - '0');
 
-	value = (static_cast<u_short>(from) << 8) | static_cast<u_short>(to);
+		if (row < 1 || row > BOARD_SIZE)
+			return;
+
+		squares[j] = static_cast<u_short>((row - 1) * BOARD_SIZE + col);
+	}
+
+	value = (squares[0] << 8) | squares[1];
 }
 
 // set from
@@ -78,6 +88,13 @@ u_short Move::get_to() {
 	return value & 0xFF;
 }
 
+// move mirrored across center files
+Move Move::mirrored() {
+	return Move(Bitboard::mirror_scalar(get_from()), Bitboard::mirror_scalar(get_to()));
+}
+
+////
+
 // to string
 // pointerBoard: pass from containing Bbot
 string Move::to_string(Piece* pointerBoard[NUM_SQUARES]) {
@@ -19,7 +19,7 @@ public:
 	Move();
 	Move(u_short from_);
 	Move(u_short from_, u_short to_);
-	Move(std::string s);
+	Move(std::string_view s);
 
 	void set_from(u_short from_);
 	void set_to(u_short to_);
@@ -29,6 +29,8 @@ public:
 	u_short get_from();
 	u_short get_to();
 
+	Move mirrored();
+
 	std::string to_string(Piece* pointerBoard[NUM_SQUARES]);
 
 	//Move& operator=(Move move);
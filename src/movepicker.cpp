@@ -0,0 +1,266 @@
+// movepicker.cpp
+
+#include "movepicker.h"
+
+namespace Bbot2 {
+
+// MovePicker //
+
+// set up picker for the current position of board
+// hashMove_: best move from TT, or 0 if none was found
+// whLines_: stage 3 filters, from containing Bbot
+// valueTable_, threatScore_: evaluation parameters scoring stage 4, from containing Bbot
+void MovePicker::init(Board* board_, Move hashMove_, bboard whLines_[NUM_TYPES], const int valueTable_[NUM_TYPES][NUM_SQUARES], int threatScore_) {
+	board = board_;
+	hashMove = hashMove_;
+	whLines = whLines_;
+	valueTable = &valueTable_[0][0];
+	threatScore = threatScore_;
+
+	stage = STAGE_HASH_MOVE;
+	numMovable = 0;
+	index = 0;
+	numMoves = 0;
+	cursor = 0;
+}
+
+// get next move to play
+// returns false when all stages are exhausted
+bool MovePicker::next(Move* result) {
+	u_long scalar;
+	bool found;
+
+	while (stage != STAGE_DONE) {
+		switch (stage) {
+			case STAGE_HASH_MOVE:
+				stage = STAGE_GENERATE;
+
+				// move from TT may be from a colliding position, so it is checked before use
+				if (hashMove.value != 0 && board->quick_is_legal(hashMove)) {
+					*result = hashMove;
+					return true;
+				}
+
+				break;
+
+			case STAGE_GENERATE:
+				generate();
+
+				stage = STAGE_WH;
+				index = 0;
+				stage_piece();
+				break;
+
+			case STAGE_REMAINING:
+				if (cursor < numMoves) {
+					*result = moves[cursor ++];
+					return true;
+				}
+
+				stage = STAGE_DONE;
+				break;
+
+			default:
+				// serialize staged moves of current piece
+				// scanning in direction most likely to return a quick success
+				if (board->sideToMove == WHITE) {
+					found = Bitboard::scan_forward(&scalar, &staged);
+				} else {
+					found = Bitboard::scan_reverse(&scalar, &staged);
+				}
+
+				if (found) {
+					staged ^= Bitboard::SQUARES[scalar]; // remove found bit
+					move.set_to(scalar); // set destination
+
+					// hash move has already been played
+					if (move == hashMove)
+						continue;
+
+					*result = move;
+					return true;
+				}
+
+				// move to next piece, or to next stage once all pieces are done
+				if (++ index >= numMovable) {
+					index = 0;
+					stage ++;
+				}
+
+				if (stage == STAGE_REMAINING)
+					score_remaining();
+				else
+					stage_piece();
+		}
+	}
+
+	return false;
+}
+
+////
+
+// update legal move sets and keep a copy of each movable piece's moves
+void MovePicker::generate() {
+	ProfileScope scope(PROFILE_MOVE_GEN);
+
+	// quickly update legal move sets
+	// doesn't properly clear forced pieces or opposite-colour pieces, but this is caught below
+	board->quick_move_sets();
+
+	numMovable = 0;
+	for (Piece* p : board->pieces[board->sideToMove]) {
+
+		// if any piece is forced, only include forced pieces
+		if (board->isSideForced && !p->isForced)
+			continue;
+
+		// buffers here and in score_remaining are sized for PIECES_PER_SIDE
+		if (numMovable == PIECES_PER_SIDE)
+			throw Exception("More than " + std::to_string(PIECES_PER_SIDE) + " pieces of a side");
+
+		movable[numMovable] = p;
+		remaining[numMovable] = p->moveBoard;
+		numMovable ++;
+	}
+}
+
+// filter current piece's remaining moves with stage's bboard
+// then remove them from the remaining moves
+void MovePicker::stage_piece() {
+	staged.reset();
+
+	if (index >= numMovable)
+		return;
+
+	Piece* p = movable[index];
+	staged = remaining[index];
+
+	// set 'from' in recorded move to current piece scalar
+	move.set_from(p->scalar);
+
+	switch (stage) {
+		case STAGE_WH: // stage 1 - watering holes
+			staged &= board->wateringHoles;
+			break;
+
+		case STAGE_THREATS: // stage 2 - threats
+			staged &= *(p->scaresMap);
+			break;
+
+		case STAGE_WH_LINES: // stage 3 - wh row/col/diags, by piece type
+			staged &= whLines[p->type];
+			break;
+	}
+
+	remaining[index] ^= staged;
+}
+
+// stage 4 - list, score, and order all remaining moves of every piece
+void MovePicker::score_remaining() {
+	ProfileScope scope(PROFILE_MOVE_GEN);
+
+	int fromIndex[MAX_MOVES];
+	int toIndex[MAX_MOVES];
+	int threats[MAX_MOVES];
+
+	numMoves = 0;
+	cursor = 0;
+
+	for (int i = 0; i < numMovable; i ++) {
+		Piece* p = movable[i];
+		bboard moveBoard = remaining[i];
+
+		// opponent pieces only threatened by p are freed by any of its moves
+		// moves scaring a piece were already taken by stage 2, and moves into a threat are illegal, so this is the only threat change
+		bboard herdAdjacent;
+		for (Piece* q : p->siblings)
+			herdAdjacent |= q->adjacent;
+
+		int freed = 0;
+		for (Piece* q : p->scares)
+			freed += q->isThreatened && p->adjacent[q->scalar] && !herdAdjacent[q->scalar];
+
+		u_long scalar;
+		bool found;
+
+		// same order as earlier stages, which ties keep
+		while (true) {
+			if (board->sideToMove == WHITE) {
+				found = Bitboard::scan_forward(&scalar, &moveBoard);
+			} else {
+				found = Bitboard::scan_reverse(&scalar, &moveBoard);
+			}
+
+			if (!found)
+				break;
+
+			moveBoard ^= Bitboard::SQUARES[scalar];
+
+			Move m(p->scalar, (u_short) scalar);
+
+			// hash move has already been played
+			if (m == hashMove)
+				continue;
+
+			// only reached if a piece sees more than 4 lines of 9 squares
+			if (numMoves == MAX_MOVES)
+				throw Exception("More than " + std::to_string(MAX_MOVES) + " moves of a side");
+
+			moves[numMoves] = m;
+			fromIndex[numMoves] = p->type * NUM_SQUARES + p->scalar;
+			toIndex[numMoves] = p->type * NUM_SQUARES + scalar;
+			threats[numMoves] = -freed;
+			numMoves ++;
+		}
+	}
+
+	score_moves(valueTable, fromIndex, toIndex, threats, threatScore, numMoves, scores);
+
+	// partial insertion sort: moves gaining value are inserted at the front, best first
+	// the move they displace takes their place, so the rest stay roughly in scan order
+	int sorted = 0;
+	for (int i = 0; i < numMoves; i ++) {
+		if (scores[i] <= 0)
+			continue;
+
+		Move m = moves[i];
+		int score = scores[i];
+		int j = i;
+
+		moves[j] = moves[sorted];
+		scores[j] = scores[sorted];
+
+		for (j = sorted; j > 0 && scores[j - 1] < score; j --) {
+			moves[j] = moves[j - 1];
+			scores[j] = scores[j - 1];
+		}
+
+		moves[j] = m;
+		scores[j] = score;
+		sorted ++;
+	}
+}
+
+// score count moves: valueTable[toIndex] - valueTable[fromIndex] + threatScore * threats
+// valueTable: flat [type * NUM_SQUARES + scalar]
+void MovePicker::score_moves(const int* valueTable, const int* fromIndex, const int* toIndex, const int* threats, int threatScore, int count, int* result) {
+	int i = 0;
+
+#if defined(BBOT_AVX2)
+	const __m256i weight = _mm256_set1_epi32(threatScore);
+
+	for (; i + 8 <= count; i += 8) {
+		__m256i from = _mm256_i32gather_epi32(valueTable, _mm256_loadu_si256((const __m256i*) &fromIndex[i]), 4);
+		__m256i to = _mm256_i32gather_epi32(valueTable, _mm256_loadu_si256((const __m256i*) &toIndex[i]), 4);
+		__m256i threat = _mm256_mullo_epi32(_mm256_loadu_si256((const __m256i*) &threats[i]), weight);
+
+		_mm256_storeu_si256((__m256i*) &result[i], _mm256_add_epi32(_mm256_sub_epi32(to, from), threat));
+	}
+#endif
+
+	// remainder, or all moves without AVX2
+	for (; i < count; i ++)
+		result[i] = valueTable[toIndex[i]] - valueTable[fromIndex[i]] + threatScore * threats[i];
+}
+
+} // end namespace Bbot2
@@ -0,0 +1,79 @@
+// movepicker.h
+
+// staged move generation for one node of the search tree
+// moves are handed out one at a time, and each stage is only generated once the previous is exhausted
+// a cutoff from the hash move or an early stage skips the cost of generating the rest
+// stages:
+// 0. hash move from TT (verified legal, no generation required)
+// 1. moves to watering holes
+// 2. moves threatening opponent
+// 3. moves to watering hole row/col/diag
+// 4. all remaining moves, best static eval delta first
+
+// remaining moves of all pieces are scored together without being played: the value table delta of the move,
+// minus THREAT_SCORE for every opponent piece that is no longer threatened once the piece moves away
+// scores are computed for the whole list at once (gathered from the value table with AVX2 where available)
+// then only moves gaining value are sorted to the front. stage 4 is mostly reached at nodes where every move is searched,
+// whose children are cheap, so a full sort there costs more than the cutoffs it finds
+
+#pragma once
+
+#include "common.h"
+#include "board.h"
+#include "piece.h"
+#include "move.h"
+#include "bitboard.h"
+#include "profile.h"
+#include "simd.h"
+
+namespace Bbot2 {
+
+enum Stage : int { STAGE_HASH_MOVE, STAGE_GENERATE, STAGE_WH, STAGE_THREATS, STAGE_WH_LINES, STAGE_REMAINING, STAGE_DONE };
+
+class MovePicker {
+public:
+	// moves of one side, at most 4 lines of 9 squares per piece
+	// holds PIECES_PER_SIDE pieces, which positions read from outside are checked for, see Board::parse_compact
+	static const int MAX_MOVES = 256;
+	static_assert(MAX_MOVES >= PIECES_PER_SIDE * 4 * (BOARD_SIZE - 1), "MAX_MOVES must hold every move of a side");
+
+private:
+	Board* board; // board to generate moves from
+	bboard* whLines; // wh row/col/diag filters for stage 3, indexed by piece type
+	const int* valueTable; // [type * NUM_SQUARES + scalar], for stage 4
+	int threatScore; // for stage 4
+
+	Move hashMove; // best move from TT, 0 if none
+	int stage = STAGE_DONE;
+
+	// legal move sets, copied from pieces when generated
+	// piece moveBoards are overwritten further down the tree, so each node keeps its own
+	Piece* movable[PIECES_PER_SIDE];
+	bboard remaining[PIECES_PER_SIDE];
+	int numMovable = 0;
+
+	int index = 0; // index of piece being serialized
+	bboard staged; // moves of current piece in current stage
+	Move move; // 'from' set to current piece
+
+	// stage 4 moves of all pieces, and their scores
+	// moves before cursor have been played
+	Move moves[MAX_MOVES];
+	int scores[MAX_MOVES];
+	int numMoves = 0;
+	int cursor = 0;
+
+public:
+	void init(Board* board_, Move hashMove_, bboard whLines_[NUM_TYPES], const int valueTable_[NUM_TYPES][NUM_SQUARES], int threatScore_);
+
+	bool next(Move* result);
+
+	static void score_moves(const int* valueTable, const int* fromIndex, const int* toIndex, const int* threats, int threatScore, int count, int* result);
+
+private:
+	void generate();
+	void stage_piece();
+	void score_remaining();
+};
+
+} // end namespace Bbot2
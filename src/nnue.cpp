@@ -0,0 +1,280 @@
+// nnue.cpp
+
+#include "nnue.h"
+#include "board.h"
+#include <fstream>
+
+using std::string;
+
+namespace Bbot2 {
+
+// Nnue //
+
+// read weights from file
+void Nnue::load(string filename) {
+	std::ifstream file(filename, std::ios::binary);
+
+	if (!file)
+		throw Exception("Could not open network " + filename);
+
+	NnueHeader expected;
+	NnueHeader header;
+	file.read(reinterpret_cast<char*>(&header), sizeof(NnueHeader));
+
+	if (!file || !std::equal(header.magic, header.magic + 8, expected.magic)
+		|| header.features != expected.features || header.l1 != expected.l1 || header.l2 != expected.l2)
+		throw Exception("Invalid network " + filename);
+
+	file.read(reinterpret_cast<char*>(l1Bias), sizeof(l1Bias));
+	file.read(reinterpret_cast<char*>(l1Weights), sizeof(l1Weights));
+	file.read(reinterpret_cast<char*>(l2Bias), sizeof(l2Bias));
+	file.read(reinterpret_cast<char*>(l2Weights), sizeof(l2Weights));
+	file.read(reinterpret_cast<char*>(&outBias), sizeof(outBias));
+	file.read(reinterpret_cast<char*>(outWeights), sizeof(outWeights));
+
+	if (!file)
+		throw Exception("Network file is truncated: " + filename);
+}
+
+// write weights to file
+void Nnue::save(string filename) const {
+	std::ofstream file(filename, std::ios::binary);
+
+	if (!file)
+		throw Exception("Could not write " + filename);
+
+	NnueHeader header;
+	file.write(reinterpret_cast<const char*>(&header), sizeof(NnueHeader));
+
+	file.write(reinterpret_cast<const char*>(l1Bias), sizeof(l1Bias));
+	file.write(reinterpret_cast<const char*>(l1Weights), sizeof(l1Weights));
+	file.write(reinterpret_cast<const char*>(l2Bias), sizeof(l2Bias));
+	file.write(reinterpret_cast<const char*>(l2Weights), sizeof(l2Weights));
+	file.write(reinterpret_cast<const char*>(&outBias), sizeof(outBias));
+	file.write(reinterpret_cast<const char*>(outWeights), sizeof(outWeights));
+}
+
+////
+
+// compute accumulator of board from its active features
+void Nnue::refresh(NnueAccumulator* acc, Board* board) const {
+	int features[NNUE_MAX_ACTIVE];
+
+	for (Side side : SIDES) {
+		int16_t* values = acc->values[side];
+		int n = active_features(board, side, features);
+
+		std::copy(l1Bias, l1Bias + NNUE_L1, values);
+
+		for (int i = 0; i < n; i ++) {
+			const int16_t* row = l1Weights[features[i]];
+
+			for (int j = 0; j < NNUE_L1; j ++)
+				values[j] += row[j];
+		}
+	}
+}
+
+// add and subtract rows of changed features, given from white's view, to both sides of accumulator
+// every side is loaded and stored once, with all changes applied in registers
+void Nnue::update(NnueAccumulator* acc, const int* added, int numAdded, const int* removed, int numRemoved) const {
+	for (Side side : SIDES) {
+		int16_t* values = acc->values[side];
+
+		const int16_t* addRows[NNUE_MAX_ACTIVE];
+		const int16_t* removeRows[NNUE_MAX_ACTIVE];
+
+		for (int i = 0; i < numAdded; i ++)
+			addRows[i] = l1Weights[side ? flip_feature(added[i]) : added[i]];
+
+		for (int i = 0; i < numRemoved; i ++)
+			removeRows[i] = l1Weights[side ? flip_feature(removed[i]) : removed[i]];
+
+#if defined(BBOT_AVX2)
+		for (int j = 0; j < NNUE_L1; j += 16) {
+			__m256i v = _mm256_load_si256((const __m256i*) &values[j]);
+
+			for (int i = 0; i < numAdded; i ++)
+				v = _mm256_add_epi16(v, _mm256_load_si256((const __m256i*) &addRows[i][j]));
+
+			for (int i = 0; i < numRemoved; i ++)
+				v = _mm256_sub_epi16(v, _mm256_load_si256((const __m256i*) &removeRows[i][j]));
+
+			_mm256_store_si256((__m256i*) &values[j], v);
+		}
+#elif defined(BBOT_SSE2)
+		for (int j = 0; j < NNUE_L1; j += 8) {
+			__m128i v = _mm_load_si128((const __m128i*) &values[j]);
+
+			for (int i = 0; i < numAdded; i ++)
+				v = _mm_add_epi16(v, _mm_load_si128((const __m128i*) &addRows[i][j]));
+
+			for (int i = 0; i < numRemoved; i ++)
+				v = _mm_sub_epi16(v, _mm_load_si128((const __m128i*) &removeRows[i][j]));
+
+			_mm_store_si128((__m128i*) &values[j], v);
+		}
+#else
+		for (int j = 0; j < NNUE_L1; j ++) {
+			int16_t v = values[j];
+
+			for (int i = 0; i < numAdded; i ++)
+				v += addRows[i][j];
+
+			for (int i = 0; i < numRemoved; i ++)
+				v -= removeRows[i][j];
+
+			values[j] = v;
+		}
+#endif
+	}
+}
+
+// evaluate accumulator for side to move, in evaluation units
+int Nnue::evaluate(const NnueAccumulator& acc, Side side) const {
+	// clipped relu of accumulator, side to move first
+	alignas(32) u_byte input[2 * NNUE_L1];
+	const int16_t* halves[2] = { acc.values[side], acc.values[!side] };
+
+	for (int h = 0; h < 2; h ++) {
+		const int16_t* values = halves[h];
+		u_byte* out = &input[h * NNUE_L1];
+
+#if defined(BBOT_AVX2)
+		const __m256i zero = _mm256_setzero_si256();
+		const __m256i max = _mm256_set1_epi16(NNUE_QA);
+
+		for (int j = 0; j < NNUE_L1; j += 32) {
+			__m256i a = _mm256_max_epi16(_mm256_min_epi16(_mm256_load_si256((const __m256i*) &values[j]), max), zero);
+			__m256i b = _mm256_max_epi16(_mm256_min_epi16(_mm256_load_si256((const __m256i*) &values[j + 16]), max), zero);
+
+			// packs within 128-bit lanes, so lanes are reordered after
+			__m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), 0xD8);
+			_mm256_store_si256((__m256i*) &out[j], packed);
+		}
+#elif defined(BBOT_SSE2)
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i max = _mm_set1_epi16(NNUE_QA);
+
+		for (int j = 0; j < NNUE_L1; j += 16) {
+			__m128i a = _mm_max_epi16(_mm_min_epi16(_mm_load_si128((const __m128i*) &values[j]), max), zero);
+			__m128i b = _mm_max_epi16(_mm_min_epi16(_mm_load_si128((const __m128i*) &values[j + 8]), max), zero);
+
+			_mm_store_si128((__m128i*) &out[j], _mm_packus_epi16(a, b));
+		}
+#else
+		for (int j = 0; j < NNUE_L1; j ++)
+			out[j] = (u_byte) std::clamp((int) values[j], 0, NNUE_QA);
+#endif
+	}
+
+	// second layer and output
+	// a neuron's sum is scaled by QA * QB, so shifting by log2(QB) leaves activations scaled by QA
+	static_assert(NNUE_QB == 64, "shift assumes NNUE_QB = 64");
+
+	int64_t out = outBias;
+
+	for (int i = 0; i < NNUE_L2; i ++) {
+		int sum = l2Bias[i] + dot(input, l2Weights[i]);
+		out += std::clamp(sum >> 6, 0, NNUE_QA) * outWeights[i];
+	}
+
+	return (int) (out * NNUE_EVAL_UNIT / (NNUE_QA * NNUE_QO));
+}
+
+// dot product of 2 * NNUE_L1 activations and weights
+// products are at most 127 * 127, so pairs summed in int16 cannot overflow
+int Nnue::dot(const u_byte* input, const int8_t* weights) {
+#if defined(BBOT_AVX2)
+	const __m256i ones = _mm256_set1_epi16(1);
+	__m256i sum = _mm256_setzero_si256();
+
+	for (int j = 0; j < 2 * NNUE_L1; j += 32) {
+		__m256i pairs = _mm256_maddubs_epi16(_mm256_load_si256((const __m256i*) &input[j]), _mm256_load_si256((const __m256i*) &weights[j]));
+		sum = _mm256_add_epi32(sum, _mm256_madd_epi16(pairs, ones));
+	}
+
+	__m128i s = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+	s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0x4E));
+	s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0xB1));
+
+	return _mm_cvtsi128_si32(s);
+#elif defined(BBOT_SSE2)
+	const __m128i zero = _mm_setzero_si128();
+	__m128i sum = _mm_setzero_si128();
+
+	for (int j = 0; j < 2 * NNUE_L1; j += 16) {
+		__m128i in = _mm_load_si128((const __m128i*) &input[j]);
+		__m128i w = _mm_load_si128((const __m128i*) &weights[j]);
+
+		// widen to int16: activations by zeros, weights by their sign
+		__m128i inLo = _mm_unpacklo_epi8(in, zero);
+		__m128i inHi = _mm_unpackhi_epi8(in, zero);
+		__m128i wLo = _mm_srai_epi16(_mm_unpacklo_epi8(w, w), 8);
+		__m128i wHi = _mm_srai_epi16(_mm_unpackhi_epi8(w, w), 8);
+
+		sum = _mm_add_epi32(sum, _mm_madd_epi16(inLo, wLo));
+		sum = _mm_add_epi32(sum, _mm_madd_epi16(inHi, wHi));
+	}
+
+	sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4E));
+	sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xB1));
+
+	return _mm_cvtsi128_si32(sum);
+#else
+	int sum = 0;
+
+	for (int j = 0; j < 2 * NNUE_L1; j ++)
+		sum += input[j] * weights[j];
+
+	return sum;
+#endif
+}
+
+////
+
+// feature seen from black: colours swapped, ranks flipped
+int Nnue::flip_feature(int feature) {
+	int block = feature / NNUE_PIECE_FEATURES;
+	int herd = feature % NNUE_PIECE_FEATURES / NUM_SQUARES;
+	int scalar = feature % NUM_SQUARES;
+
+	herd = (herd + NUM_TYPES) % NUM_HERDS;
+	scalar = (BOARD_SIZE - 1 - scalar / BOARD_SIZE) * BOARD_SIZE + scalar % BOARD_SIZE;
+
+	return block * NNUE_PIECE_FEATURES + herd * NUM_SQUARES + scalar;
+}
+
+// active features of board, from the view of side
+// returns number of features
+int Nnue::active_features(Board* board, Side side, int features[NNUE_MAX_ACTIVE]) {
+	int n = 0;
+
+	for (Side s : SIDES) {
+		for (Piece* p : board->pieces[s]) {
+			features[n ++] = piece_feature(p->herd, p->scalar);
+
+			if (p->isThreatened)
+				features[n ++] = threat_feature(p->herd, p->scalar);
+		}
+	}
+
+	if (side == BLACK)
+		for (int i = 0; i < n; i ++)
+			features[i] = flip_feature(features[i]);
+
+	return n;
+}
+
+// instruction set of inference, as compiled
+const char* Nnue::simd_name() {
+#if defined(BBOT_AVX2)
+	return "AVX2";
+#elif defined(BBOT_SSE2)
+	return "SSE2";
+#else
+	return "scalar";
+#endif
+}
+
+} // end namespace Bbot2
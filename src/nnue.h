@@ -0,0 +1,94 @@
+// nnue.h
+
+// efficiently updatable neural network evaluation, an optional replacement of Bbot's value tables
+// inputs are sparse binary features: one per (herd, square) of each piece, and one per (herd, square) of each threatened piece
+// the first layer is an accumulator of the weight rows of active features. a move only changes a few features,
+// so Board keeps the accumulator up to date in move_piece, adding and subtracting rows instead of recomputing the layer
+
+// features are seen from both sides. from black's view, colours are swapped and ranks are flipped,
+// which maps the board onto itself (start position and watering holes are symmetric), so both views share one first layer
+// layers: 2 x (NNUE_FEATURES -> NNUE_L1) accumulator, side to move first -> clipped relu -> NNUE_L2 -> clipped relu -> 1
+
+// inference is integer: accumulator in int16 (scaled by NNUE_QA), second layer weights in int8 (scaled by NNUE_QB)
+// activations are clipped to 0..127 and stored as u_byte, output weights in int16 (scaled by NNUE_QO)
+// the output is a win logit for the side to move, 1.0 = 73%, scaled to evaluation units by NNUE_EVAL_UNIT (one watering hole)
+// AVX2 and SSE2 kernels are used when compiled for them, otherwise a scalar fallback
+
+// weights are trained by NnueTrainer on positions from self-play (see Tuner::generate), and saved as a binary file:
+// NnueHeader, then in order: l1Bias, l1Weights, l2Bias, l2Weights, outBias, outWeights, all little-endian
+
+#pragma once
+
+#include "common.h"
+#include "log.h"
+#include "simd.h"
+#include <cstdint>
+
+namespace Bbot2 {
+
+class Board;
+
+// sizes
+constexpr int NNUE_PIECE_FEATURES = NUM_HERDS * NUM_SQUARES;
+constexpr int NNUE_FEATURES = 2 * NNUE_PIECE_FEATURES; // piece features, then threat features
+constexpr int NNUE_MAX_ACTIVE = 2 * NUM_PIECES; // every piece, every piece threatened
+// pieces scared by a moving piece that are updated incrementally, see Board::threat_flags and Board::update_accumulator
+// its changes (2 piece features, 1 threat of its own, 1 per scared piece) must fit NNUE_MAX_ACTIVE
+constexpr int NNUE_MAX_SCARED = NNUE_MAX_ACTIVE - 4;
+static_assert(NNUE_MAX_SCARED + 1 <= 32, "threat flags of moving piece and scared pieces must fit a 32-bit u_long");
+const int NNUE_L1 = 128; // accumulator size, per side
+const int NNUE_L2 = 32;
+
+// quantization
+const int NNUE_QA = 127; // first layer, and activations: 1.0 = 127
+const int NNUE_QB = 64; // second layer weights
+const int NNUE_QO = 256; // output weights
+const int NNUE_EVAL_UNIT = 20000; // evaluation of a logit of 1.0, see Bbot::ON_WH_SCORE
+
+// file header
+typedef struct NnueHeader {
+	char magic[8] = { 'B', 'B', 'O', 'T', '2', 'N', 'N', '1' };
+	int32_t features = NNUE_FEATURES;
+	int32_t l1 = NNUE_L1;
+	int32_t l2 = NNUE_L2;
+	int32_t reserved = 0;
+} NnueHeader;
+
+static_assert(sizeof(NnueHeader) == 24, "NnueHeader must be packed to 24 bytes");
+
+// first layer of a position, from the view of each side [side][neuron]
+typedef struct NnueAccumulator {
+	alignas(32) int16_t values[NUM_SIDES][NNUE_L1];
+} NnueAccumulator;
+
+class Nnue {
+public:
+	// weights, quantized
+	alignas(32) int16_t l1Bias[NNUE_L1];
+	alignas(32) int16_t l1Weights[NNUE_FEATURES][NNUE_L1]; // row per feature
+	alignas(32) int32_t l2Bias[NNUE_L2];
+	alignas(32) int8_t l2Weights[NNUE_L2][2 * NNUE_L1]; // row per neuron
+	int32_t outBias = 0;
+	alignas(32) int16_t outWeights[NNUE_L2];
+
+	void load(std::string filename);
+	void save(std::string filename) const;
+
+	void refresh(NnueAccumulator* acc, Board* board) const;
+	void update(NnueAccumulator* acc, const int* added, int numAdded, const int* removed, int numRemoved) const;
+
+	int evaluate(const NnueAccumulator& acc, Side side) const;
+
+	// features
+	static int piece_feature(int herd, int scalar) { return herd * NUM_SQUARES + scalar; }
+	static int threat_feature(int herd, int scalar) { return NNUE_PIECE_FEATURES + herd * NUM_SQUARES + scalar; }
+	static int flip_feature(int feature);
+	static int active_features(Board* board, Side side, int features[NNUE_MAX_ACTIVE]);
+
+	static const char* simd_name();
+
+private:
+	static int dot(const u_byte* input, const int8_t* weights);
+};
+
+} // end namespace Bbot2
@@ -38,6 +38,11 @@ public:
 	bboard sightBoard;
 	bboard moveBoard; // set of moves (pseudo-legal inside search, legal outside search)
 
+	// squares of sightBoard outside scaredByMap, counted by Board::update_safe_squares
+	bool schedSafeUpdate = true; // if true, recounted on next update, as sight or scaredByMap changed
+	int safeSquares = 0;
+	int safeWH = 0; // watering holes among safe squares
+
 	std::vector<Piece*> scares; // points to pieces that this piece scares
 	std::vector<Piece*> siblings; // points to pieces that shares herd
 
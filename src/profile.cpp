@@ -0,0 +1,100 @@
+// profile.cpp
+
+#include "profile.h"
+#include <fstream>
+
+using std::string;
+using std::format;
+
+namespace Bbot2 {
+
+namespace Profiler {
+
+// entry of current thread, created on its first timed scope
+ProfileThread* local() {
+	if (current == nullptr) {
+		std::lock_guard<std::mutex> guard(lock);
+
+		threads.push_back(std::make_unique<ProfileThread>());
+		current = threads.back().get();
+		current->id = (int) threads.size() - 1;
+	}
+
+	return current;
+}
+
+// rate of tick clock, measured against steady_clock since start
+double ticks_per_us() {
+#ifdef BBOT_RDTSC
+	double us = (double) std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTime).count();
+	return us > 0 ? (now() - startTicks) / us : 1;
+#else
+	return 1000; // ns
+#endif
+}
+
+// print time and calls per phase, summed over all threads
+// call once all profiled threads are done
+void print() {
+	std::lock_guard<std::mutex> guard(lock);
+
+	double rate = ticks_per_us();
+	unsigned __int64 ticks[NUM_PROFILE_PHASES] = {};
+	unsigned __int64 calls[NUM_PROFILE_PHASES] = {};
+
+	for (auto& t : threads) {
+		for (int i = 0; i < NUM_PROFILE_PHASES; i ++) {
+			ticks[i] += t->ticks[i];
+			calls[i] += t->calls[i];
+		}
+	}
+
+	__PRINT(format("\nPROFILE: {} threads\n", threads.size()));
+	__PRINT(format("   {:<12} {:>12} {:>12} {:>10} {:>8}\n", "PHASE", "CALLS", "TIME (ms)", "ns/CALL", "SEARCH"));
+
+	for (int i = 0; i < NUM_PROFILE_PHASES; i ++) {
+		double us = ticks[i] / rate;
+		double share = ticks[PROFILE_SEARCH] > 0 ? (double) ticks[i] / ticks[PROFILE_SEARCH] * 100 : 0;
+
+		__PRINT(format("   {:<12} {:>12} {:>12.1f} {:>10.1f} {:>7.1f}%\n", PROFILE_PHASE_NAMES[i], calls[i], us / 1000,
+			calls[i] > 0 ? us * 1000 / calls[i] : 0, share));
+	}
+
+	// search time by thread
+	if (threads.size() > 1)
+		for (auto& t : threads)
+			__PRINT(format("   THREAD {}: {:.1f} ms searching\n", t->id, t->ticks[PROFILE_SEARCH] / rate / 1000));
+}
+
+// write traced scopes of all threads as Chrome trace JSON
+// call once all profiled threads are done
+void write_trace(string filename) {
+	std::lock_guard<std::mutex> guard(lock);
+
+	std::ofstream file(filename, std::ios::trunc);
+
+	if (!file)
+		throw Exception("Could not write " + filename);
+
+	double rate = ticks_per_us();
+	bool first = true;
+
+	file << "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [\n";
+
+	for (auto& t : threads) {
+		for (ProfileEvent& e : t->events) {
+			file << (first ? "" : ",\n") << "{\"name\": \"" << PROFILE_PHASE_NAMES[e.phase] << "\", \"ph\": \"X\", \"pid\": 0, \"tid\": " << t->id
+				<< format(", \"ts\": {:.3f}, \"dur\": {:.3f}", (e.start - startTicks) / rate, (e.end - e.start) / rate) << "}";
+
+			first = false;
+		}
+	}
+
+	file << "\n]}\n";
+
+	__PRINT("Profile trace written to " + filename + "\n");
+}
+
+} // end namespace Profiler
+
+} // end namespace Bbot2
@@ -0,0 +1,118 @@
+// profile.h
+
+// scoped timers around the hot paths of the search, switched on by PROFILE in common.h
+// when PROFILE is off, ProfileScope is empty and compiles away, so timers may stay in production code
+
+// every thread accumulates time and calls per phase in its own ProfileThread, so timing takes no locks
+// results of all threads are printed as a flat summary, or exported as a Chrome trace (chrome://tracing, ui.perfetto.dev)
+// the trace holds the first MAX_TRACE_EVENTS timed scopes of each thread, as a full search times millions
+
+// time is read from the CPU timestamp counter (rdtsc) where available, otherwise from steady_clock
+// ticks are converted to time by comparing both clocks over the life of the process
+
+#pragma once
+
+#include "common.h"
+#include "log.h"
+#include <chrono>
+#include <memory>
+#include <mutex>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define BBOT_RDTSC
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BBOT_RDTSC
+#endif
+
+namespace Bbot2 {
+
+// timed phases
+// phases other than SEARCH do not contain each other, so their times add up to part of SEARCH
+enum ProfilePhase : int {
+	PROFILE_SEARCH, PROFILE_MOVE_GEN, PROFILE_EVAL, PROFILE_TT_LOOKUP, PROFILE_TT_STORE, PROFILE_GH, PROFILE_MAKE_MOVE,
+	NUM_PROFILE_PHASES
+};
+
+const std::string PROFILE_PHASE_NAMES[NUM_PROFILE_PHASES] = {
+	"SEARCH", "MOVE GEN", "STATIC EVAL", "TT LOOKUP", "TT STORE", "GH", "MAKE/UNMAKE"
+};
+
+// timed scope, for trace
+typedef struct ProfileEvent {
+	unsigned __int64 start;
+	unsigned __int64 end;
+	ProfilePhase phase;
+} ProfileEvent;
+
+// totals of one thread
+typedef struct ProfileThread {
+	int id; // in order of first timed scope
+	unsigned __int64 ticks[NUM_PROFILE_PHASES] = {};
+	unsigned __int64 calls[NUM_PROFILE_PHASES] = {};
+	std::vector<ProfileEvent> events; // up to MAX_TRACE_EVENTS
+} ProfileThread;
+
+namespace Profiler {
+	inline const size_t MAX_TRACE_EVENTS = 1 << 20; // per thread, 24 bytes each
+
+	// every thread that timed a scope, kept after it exits. guarded by lock
+	inline std::mutex lock;
+	inline std::vector<std::unique_ptr<ProfileThread>> threads;
+
+	inline thread_local ProfileThread* current = nullptr; // this thread's entry in threads, once created
+
+	// current time in ticks
+	inline unsigned __int64 now() {
+#ifdef BBOT_RDTSC
+		return __rdtsc();
+#else
+		return (unsigned __int64) std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+	}
+
+	// clocks when profiling started, to convert ticks to time
+	inline const unsigned __int64 startTicks = now();
+	inline const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+	ProfileThread* local();
+
+	// add timed scope to current thread
+	inline void add(ProfilePhase phase, unsigned __int64 start, unsigned __int64 end) {
+		ProfileThread* t = current != nullptr ? current : local();
+
+		t->ticks[phase] += end - start;
+		t->calls[phase] ++;
+
+		if (t->events.size() < MAX_TRACE_EVENTS)
+			t->events.push_back({ start, end, phase });
+	}
+
+	double ticks_per_us();
+	void print();
+	void write_trace(std::string filename);
+
+} // end namespace Profiler
+
+// times its lifetime as a phase of the current thread, if PROFILE is on
+class ProfileScope {
+	unsigned __int64 start = 0;
+	ProfilePhase phase;
+
+public:
+	ProfileScope(ProfilePhase phase_) : phase(phase_) {
+		if constexpr (PROFILE)
+			start = Profiler::now();
+	}
+
+	~ProfileScope() {
+		if constexpr (PROFILE)
+			Profiler::add(phase, start, Profiler::now());
+	}
+
+	ProfileScope(const ProfileScope&) = delete;
+	ProfileScope& operator=(const ProfileScope&) = delete;
+};
+
+} // end namespace Bbot2
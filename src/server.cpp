@@ -0,0 +1,496 @@
+// server.cpp
+
+#include "server.h"
+#include <sstream>
+#include <thread>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "Ws2_32.lib")
+#else
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <signal.h>
+#include <cerrno>
+#endif
+
+using std::string;
+using std::vector;
+using std::format;
+
+namespace Bbot2 {
+
+// sockets
+
+static void close_socket(socket_t s) {
+#ifdef _WIN32
+	closesocket(s);
+#else
+	::close(s);
+#endif
+}
+
+static bool set_nonblocking(socket_t s) {
+#ifdef _WIN32
+	u_long mode = 1;
+	return ioctlsocket(s, FIONBIO, &mode) == 0;
+#else
+	return fcntl(s, F_SETFL, fcntl(s, F_GETFL, 0) | O_NONBLOCK) == 0;
+#endif
+}
+
+// true if last failed call on a non-blocking socket only had to wait
+static bool would_block() {
+#ifdef _WIN32
+	return WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+	return errno == EAGAIN || errno == EWOULDBLOCK;
+#endif
+}
+
+static int poll_sockets(vector<pollfd>& fds, int timeout) {
+#ifdef _WIN32
+	return WSAPoll(fds.data(), (ULONG) fds.size(), timeout);
+#else
+	return poll(fds.data(), (nfds_t) fds.size(), timeout);
+#endif
+}
+
+// UDP socket on localhost connected to itself, see Server::waker
+static bool open_waker(socket_t* s) {
+	sockaddr_in addr = {};
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	addr.sin_port = 0; // any free port
+
+	socklen_t len = sizeof(addr);
+	*s = socket(AF_INET, SOCK_DGRAM, 0);
+
+	if (bind(*s, (sockaddr*) &addr, sizeof(addr)) != 0 || getsockname(*s, (sockaddr*) &addr, &len) != 0
+		|| connect(*s, (sockaddr*) &addr, sizeof(addr)) != 0 || !set_nonblocking(*s)) {
+		close_socket(*s);
+		return false;
+	}
+
+	return true;
+}
+
+// payload with length prefix
+static string frame(const string& payload) {
+	size_t len = payload.size();
+	string s(4, '\0');
+
+	for (int i = 0; i < 4; i ++)
+		s[i] = (char) ((len >> (8 * i)) & 0xFF);
+
+	return s + payload;
+}
+
+////////////////////////////////
+
+// Server //
+
+// get settings from .ini
+// engines are configured by the same .ini, so it must outlive run()
+void Server::settings(CSimpleIniA* config_) {
+	config = config_;
+
+	maxTime = (int) config->GetLongValue("COMPUTER_PLAYER", "time-limit", maxTime);
+	maxDepth = (int) config->GetLongValue("COMPUTER_PLAYER", "depth-limit", maxDepth);
+	multiPV = (int) config->GetLongValue("COMPUTER_PLAYER", "multipv", multiPV);
+	TT_ALLOC = (u_long) config->GetLongValue("COMPUTER_PLAYER", "transposition-table-allocation", TT_ALLOC);
+}
+
+// start listening
+// address: port number for localhost TCP, otherwise path of a Unix domain socket
+void Server::open(string address) {
+	bool tcp = !address.empty() && std::all_of(address.begin(), address.end(), [](char c) { return std::isdigit((unsigned char) c); });
+
+#ifdef _WIN32
+	WSADATA wsa;
+	if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0)
+		throw Exception("Could not start Winsock");
+
+	if (!tcp)
+		throw Exception("Unix domain sockets are not supported on Windows, use a port number");
+#else
+	// a client closing early must not end the server
+	signal(SIGPIPE, SIG_IGN);
+#endif
+
+	if (tcp) {
+		sockaddr_in addr = {};
+		addr.sin_family = AF_INET;
+		addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		addr.sin_port = htons((u_short) std::stoi(address));
+
+		listener = socket(AF_INET, SOCK_STREAM, 0);
+
+		int reuse = 1;
+		setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, (const char*) &reuse, sizeof(reuse));
+
+		if (bind(listener, (sockaddr*) &addr, sizeof(addr)) != 0) {
+			close_socket(listener);
+			throw Exception("Could not bind to port " + address);
+		}
+	} else {
+#ifndef _WIN32
+		sockaddr_un addr = {};
+		addr.sun_family = AF_UNIX;
+
+		if (address.size() >= sizeof(addr.sun_path))
+			throw Exception("Socket path too long: " + address);
+
+		memcpy(addr.sun_path, address.c_str(), address.size());
+
+		// socket file is left behind by a server that did not close
+		unlink(address.c_str());
+
+		listener = socket(AF_UNIX, SOCK_STREAM, 0);
+
+		if (bind(listener, (sockaddr*) &addr, sizeof(addr)) != 0) {
+			close_socket(listener);
+			throw Exception("Could not bind to " + address);
+		}
+
+		socketPath = address;
+#endif
+	}
+
+	if (listen(listener, SOMAXCONN) != 0 || !set_nonblocking(listener)) {
+		close_socket(listener);
+		throw Exception("Could not listen on " + address);
+	}
+
+	listening = true;
+
+	if (!open_waker(&waker)) {
+		close();
+		throw Exception("Could not open wake-up socket");
+	}
+
+	wakerOpen = true;
+}
+
+// serve requests until stopped
+// shareTT: engines share one TT of size TT_ALLOC, instead of allocating one each
+void Server::run(int numThreads, bool shareTT) {
+	if (shareTT)
+		sharedTT.assign(Bbot::tt_size(TT_ALLOC), TT());
+
+	vector<std::thread> threads;
+	for (int i = 0; i < numThreads; i ++)
+		threads.push_back(std::thread(&Server::worker, this));
+
+	__PRINT(format("Serving with {} engines\n", numThreads));
+
+	vector<pollfd> fds;
+	vector<u_long> ids; // client of each fd after the listener
+
+	while (!stopped) {
+
+		// queue finished responses
+		{
+			std::lock_guard<std::mutex> guard(responseLock);
+
+			for (auto& [client, payload] : responses)
+				send(client, payload);
+
+			responses.clear();
+		}
+
+		fds.clear();
+		ids.clear();
+		fds.push_back({ listener, POLLIN, 0 });
+		fds.push_back({ waker, POLLIN, 0 });
+
+		for (auto& [id, client] : clients) {
+			fds.push_back({ client.socket, (short) (POLLIN | (client.out.empty() ? 0 : POLLOUT)), 0 });
+			ids.push_back(id);
+		}
+
+		// sleep until a socket is ready or woken
+		if (poll_sockets(fds, -1) <= 0)
+			continue;
+
+		if (fds[0].revents & POLLIN)
+			accept_clients();
+
+		// woken: responses and stopped are checked on the next loop
+		if (fds[1].revents & POLLIN) {
+			char buffer[64];
+			while (recv(waker, buffer, sizeof(buffer), 0) > 0);
+		}
+
+		for (size_t i = 0; i < ids.size(); i ++) {
+			short events = fds[i + 2].revents;
+			bool open = true;
+
+			if (events & (POLLIN | POLLHUP | POLLERR))
+				open = read_client(ids[i]);
+
+			if (open && (events & POLLOUT))
+				open = write_client(ids[i]);
+
+			if (!open || (events & POLLNVAL)) {
+				close_socket(clients[ids[i]].socket);
+				clients.erase(ids[i]);
+			}
+		}
+	}
+
+	// wake and join engines
+	{
+		std::lock_guard<std::mutex> guard(jobLock);
+	}
+	jobReady.notify_all();
+
+	for (std::thread& t : threads)
+		t.join();
+
+	sharedTT.clear();
+	sharedTT.shrink_to_fit();
+}
+
+// stop serving, may be called from any thread
+// run returns once engines have finished their current requests
+void Server::stop() {
+	stopped = true;
+	wake();
+}
+
+// wake network thread from poll
+// if datagrams are already waiting, it is awake anyway, so a failed send is ignored
+void Server::wake() {
+	if (wakerOpen)
+		::send(waker, "w", 1, 0);
+}
+
+// close connections and stop listening
+void Server::close() {
+	for (auto& [id, client] : clients)
+		close_socket(client.socket);
+
+	clients.clear();
+
+	if (listening)
+		close_socket(listener);
+
+	listening = false;
+
+	if (wakerOpen)
+		close_socket(waker);
+
+	wakerOpen = false;
+
+#ifdef _WIN32
+	WSACleanup();
+#else
+	if (!socketPath.empty())
+		unlink(socketPath.c_str());
+#endif
+
+	socketPath.clear();
+}
+
+////
+
+// search requests until stopped
+// each thread has its own engine, kept warm between requests
+void Server::worker() {
+	try {
+
+	AnalysisEngine engine;
+	engine.init(config, &sharedTT);
+
+	while (true) {
+		ServerJob job;
+
+		{
+			std::unique_lock<std::mutex> guard(jobLock);
+			jobReady.wait(guard, [this] { return stopped || !jobs.empty(); });
+
+			if (stopped)
+				break;
+
+			job = jobs.front();
+			jobs.pop_front();
+		}
+
+		string result = engine.analyse(job.position, job.id, job.maxTime, job.maxDepth, false, multiPV);
+
+		{
+			std::lock_guard<std::mutex> guard(responseLock);
+			responses.push_back({ job.client, result });
+		}
+
+		wake();
+	}
+
+	engine.close();
+
+	} catch (Exception e) {
+		e.print();
+	}
+}
+
+////
+
+// accept all waiting connections
+void Server::accept_clients() {
+	socket_t s;
+
+	while (true) {
+		s = accept(listener, nullptr, nullptr);
+
+#ifdef _WIN32
+		if (s == INVALID_SOCKET)
+			return;
+#else
+		if (s < 0)
+			return;
+#endif
+
+		if (!set_nonblocking(s)) {
+			close_socket(s);
+			continue;
+		}
+
+		clients[nextClient ++] = { s, "", "" };
+	}
+}
+
+// receive from client, and handle every complete frame
+// returns false if connection is closed or invalid
+bool Server::read_client(u_long id) {
+	ServerClient& client = clients[id];
+	char buffer[MAX_FRAME_LEN];
+	bool open = true;
+
+	while (true) {
+		int n = (int) recv(client.socket, buffer, sizeof(buffer), 0);
+
+		if (n < 0) {
+			open = would_block();
+			break;
+		}
+
+		// closed, but frames sent before closing are still handled
+		if (n == 0) {
+			open = false;
+			break;
+		}
+
+		client.in.append(buffer, n);
+	}
+
+	// complete frames
+	while (client.in.size() >= 4) {
+		size_t len = 0;
+
+		for (int i = 0; i < 4; i ++)
+			len |= (size_t) (unsigned char) client.in[i] << (8 * i);
+
+		if (len > MAX_FRAME_LEN)
+			return false;
+
+		if (client.in.size() < 4 + len)
+			break;
+
+		string payload = client.in.substr(4, len);
+		client.in.erase(0, 4 + len);
+
+		handle_request(id, payload);
+	}
+
+	return open;
+}
+
+// send queued frames to client
+// returns false if connection is closed
+bool Server::write_client(u_long id) {
+	ServerClient& client = clients[id];
+
+	while (!client.out.empty()) {
+		int n = (int) ::send(client.socket, client.out.data(), (int) client.out.size(), 0);
+
+		if (n < 0)
+			return would_block();
+
+		client.out.erase(0, n);
+	}
+
+	return true;
+}
+
+// read request and queue it for an engine
+void Server::handle_request(u_long client, string payload) {
+	if (payload == "quit") {
+		if (allowClientQuit)
+			stopped = true;
+		else
+			send(client, "{\"id\": null, \"error\": \"Clients may not stop the server\"}");
+
+		return;
+	}
+
+	std::istringstream tokens(payload);
+	ServerJob job;
+	job.client = client;
+
+	if (!(tokens >> job.id)) {
+		send(client, "{\"id\": null, \"error\": \"Expected request id\"}");
+		return;
+	}
+
+	if (!(tokens >> job.maxTime >> job.maxDepth)) {
+		send(client, "{" + format("\"id\": {}, \"error\": \"Expected time and depth limits\"", job.id) + "}");
+		return;
+	}
+
+	// rest of payload is position
+	string rest;
+	std::getline(tokens, rest, '\0');
+
+	string squares;
+	vector<AnalysisJob> found;
+
+	if (!Analysis::parse_positions(rest, &squares, &found) || found.size() != 1 || !squares.empty()) {
+		send(client, "{" + format("\"id\": {}, \"error\": \"Expected one position\"", job.id) + "}");
+		return;
+	}
+
+	job.position = found[0];
+
+	if (job.maxTime <= 0)
+		job.maxTime = maxTime;
+
+	if (job.maxDepth <= 0)
+		job.maxDepth = maxDepth;
+
+	{
+		std::lock_guard<std::mutex> guard(jobLock);
+		jobs.push_back(job);
+	}
+
+	jobReady.notify_one();
+}
+
+// queue payload to be sent to client
+// dropped if client has disconnected
+void Server::send(u_long client, string payload) {
+	auto it = clients.find(client);
+
+	if (it != clients.end())
+		it->second.out += frame(payload);
+}
+
+} // end namespace Bbot2
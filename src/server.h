@@ -0,0 +1,125 @@
+// server.h
+
+// local analysis service, answering requests of many clients with a pool of warm engines
+// engines are initialized once when the server starts, so a request only costs its search
+
+// listens on a Unix domain socket if address is a file path, or on localhost TCP if address is a port number
+// Unix domain sockets are not available on Windows
+
+// protocol: every message is a frame of a 4-byte little-endian payload length, followed by the payload
+// request payload:  <id> <time-limit (ms)> <depth-limit> <position>
+//   id is any non-negative integer, echoed in the response. a limit of 0 uses the limit from .ini
+//   position as in an analysis positions file, see analysis.h
+// response payload: the JSON result of the request, see analysis.h
+//   or {"id": <id>, "error": "<message>"} if the request could not be read
+// a client may send several requests without waiting. responses are sent in order of completion
+// the server is stopped by stop(), e.g. from the console. a request payload of "quit" only stops it if allowClientQuit is set
+
+// one network thread multiplexes all connections with poll, and hands requests to the engine threads through a queue
+// it sleeps in poll until a socket is ready, or until woken by another thread through a loopback socket (see wake),
+// once an engine has finished a response or the server is stopped
+
+#pragma once
+
+#include "common.h"
+#include "log.h"
+#include "analysis.h"
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <map>
+
+namespace Bbot2 {
+
+#ifdef _WIN32
+typedef unsigned __int64 socket_t; // SOCKET
+#else
+typedef int socket_t;
+#endif
+
+// request waiting for an engine
+typedef struct ServerJob {
+	u_long client; // connection it came from
+	size_t id; // request id, from client
+	int maxTime;
+	int maxDepth;
+	AnalysisJob position;
+} ServerJob;
+
+// connection
+typedef struct ServerClient {
+	socket_t socket;
+	std::string in; // received, not yet a complete frame
+	std::string out; // frames not yet sent
+} ServerClient;
+
+class Server {
+public:
+	////
+
+	//// SETTINGS ////
+
+	int maxTime = 1000; // ms per request, if not given
+	int maxDepth = MAX_LINE_LEN;
+	int multiPV = 1; // lines per request
+
+	u_long TT_ALLOC = 1 << 20; // size of shared TT, if used
+
+	// usually overrided by .ini in settings()
+
+	bool allowClientQuit = false; // if true, any client may stop the server with "quit"
+
+	static const size_t MAX_FRAME_LEN = 4096; // longer frames close their connection
+
+	////
+
+private:
+	CSimpleIniA* config = nullptr; // engine settings
+
+	socket_t listener;
+	bool listening = false;
+	std::string socketPath; // Unix domain socket file, removed on close
+
+	// UDP socket on localhost, connected to itself. a datagram sent to it wakes the network thread from poll
+	// a self-pipe that also works with WSAPoll, which only takes sockets
+	socket_t waker;
+	bool wakerOpen = false;
+
+	// connections, only used by network thread
+	std::map<u_long, ServerClient> clients;
+	u_long nextClient = 0;
+
+	std::atomic<bool> stopped = false;
+
+	// requests, guarded by jobLock
+	std::mutex jobLock;
+	std::condition_variable jobReady;
+	std::deque<ServerJob> jobs;
+
+	// responses, guarded by responseLock
+	std::mutex responseLock;
+	std::vector<std::pair<u_long, std::string>> responses;
+
+	std::vector<TT> sharedTT; // empty if every engine has its own TT
+
+public:
+	void settings(CSimpleIniA* config_);
+
+	void open(std::string address);
+	void run(int numThreads, bool shareTT);
+	void stop();
+	void close();
+
+private:
+	void worker();
+	void wake();
+
+	void accept_clients();
+	bool read_client(u_long id);
+	bool write_client(u_long id);
+	void handle_request(u_long client, std::string payload);
+	void send(u_long client, std::string payload);
+};
+
+} // end namespace Bbot2
@@ -0,0 +1,15 @@
+// simd.h
+
+// instruction sets of vectorized kernels, as compiled
+// BBOT_AVX2 if compiled for AVX2 (/arch:AVX2, -mavx2), otherwise BBOT_SSE2 on x86 where SSE2 is available
+// kernels keep a scalar fallback for anything else
+
+#pragma once
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define BBOT_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define BBOT_SSE2
+#endif
@@ -0,0 +1,408 @@
+// solver.cpp
+
+#include "solver.h"
+
+using std::string;
+using std::vector;
+
+namespace Bbot2 {
+
+// Solver //
+
+// constructor
+Solver::Solver(Board* board_)
+	: board(board_) {}
+
+// get settings from .ini
+void Solver::settings(CSimpleIniA* config) {
+	TABLE_ALLOC = (u_long) config->GetLongValue("SOLVER", "table-allocation", TABLE_ALLOC);
+	MAX_PLIES = (int) config->GetLongValue("SOLVER", "max-plies", MAX_PLIES);
+	NODE_LIMIT = (unsigned __int64) config->GetLongValue("SOLVER", "node-limit", (long) NODE_LIMIT);
+	TIME_LIMIT = config->GetLongValue("SOLVER", "time-limit", (long) TIME_LIMIT);
+}
+
+// allocate table
+void Solver::init() {
+	// round up to nearest 2^n, at least one bucket
+	u_long size = 2;
+	while (size < TABLE_ALLOC) size <<= 1;
+
+	TABLE_ALLOC = size;
+	table = new SolverEntry[TABLE_ALLOC];
+	tableMask = TABLE_ALLOC - 1;
+}
+
+// solve position of board for its side to move
+// board is left as given. the table is kept, so solving a following position of the same game for the same side reuses it
+// entries are relative to the attacker, so the table is cleared when the attacker changes
+Solution Solver::solve() {
+	Solution solution;
+
+	if (SIDES[board->sideToMove] != attacker)
+		std::fill(table, table + TABLE_ALLOC, SolverEntry());
+
+	attacker = SIDES[board->sideToMove];
+	path.clear();
+	nodes = 0;
+	aborted = false;
+	startClock = std::chrono::steady_clock::now();
+
+	ProofNumbers root;
+	search(INF, INF, &root);
+
+	// numbers of an aborted search are incomplete
+	if (aborted) {
+		solution.result = SOLVE_UNKNOWN;
+	} else if (root.pn == 0) {
+		solution.result = SOLVE_WIN;
+		proof_line(&solution.line);
+	} else if (root.dn == 0) {
+		solution.result = SOLVE_NO_WIN;
+	}
+
+	solution.nodes = nodes;
+	solution.time = std::chrono::duration<double>(std::chrono::steady_clock::now() - startClock).count();
+
+	__LOG("Solver: {} nodes in {:.3f}s, pn {} dn {}", nodes, solution.time, root.pn, root.dn);
+
+	// move sets were left at the last position generated
+	board->update_move_sets();
+
+	return solution;
+}
+
+// deallocate table
+void Solver::close() {
+	delete[] table;
+	table = nullptr;
+}
+
+////
+
+// expand position until its proof or disproof number reaches its threshold, or it is solved
+// result: numbers of position
+void Solver::search(u_long thpn, u_long thdn, ProofNumbers* result) {
+	nodes ++;
+
+	// result is left as is, and nothing is stored, once aborted
+	if (check_limits())
+		return;
+
+	if ((int) path.size() >= MAX_PLIES) {
+		*result = { INF, 0, 0 };
+		return;
+	}
+
+	vector<Move> moves;
+	ProofNumbers numbers;
+
+	if (generate(&moves, &numbers)) {
+		store(numbers, 1);
+		*result = numbers;
+		return;
+	}
+
+	bool orNode = board->sideToMove == attacker;
+	unsigned __int64 startNodes = nodes;
+
+	path.push_back(board->ttKey);
+
+	// numbers of children are only looked up once. afterwards only the child searched can change,
+	// apart from transpositions, which are picked up on the next visit
+	vector<ProofNumbers> children(moves.size());
+	for (size_t i = 0; i < moves.size(); i ++)
+		children[i] = child_numbers(moves[i]);
+
+	while (true) {
+		int best;
+		u_long second;
+
+		numbers = combine(orNode, children, &best, &second);
+
+		if (numbers.pn >= thpn || numbers.dn >= thdn || aborted)
+			break;
+
+		// thresholds of child: search it until it is no longer the most-proving, or its parent reaches a threshold
+		u_long childThpn, childThdn;
+		u_long limit = (second >= INF) ? INF : second + 1;
+
+		if (orNode) {
+			childThpn = (std::min)(thpn, limit);
+			childThdn = (std::min)(INF, thdn - numbers.dn + children[best].dn);
+		} else {
+			childThpn = (std::min)(INF, thpn - numbers.pn + children[best].pn);
+			childThdn = (std::min)(thdn, limit);
+		}
+
+		make_move(moves[best]);
+		search(childThpn, childThdn, &children[best]);
+		unmake_move(moves[best]);
+	}
+
+	path.pop_back();
+
+	if (aborted)
+		return;
+
+	store(numbers, (u_long) (std::min)(nodes - startNodes, (unsigned __int64) INF));
+	*result = numbers;
+}
+
+// generate moves of position, unless it is already decided
+// returns true with terminal set if decided, where a won position has its winning move as its only move
+bool Solver::generate(vector<Move>* moves, ProofNumbers* terminal) {
+	Side mover = SIDES[!board->sideToMove];
+	Move move;
+
+	// side that just moved holds enough watering holes, only possible at the root
+	if ((board->occupancyBySide[mover] & board->wateringHoles).count() >= NUM_WH_TO_WIN) {
+		*terminal = (mover == attacker) ? ProofNumbers{ 0, INF, 0 } : ProofNumbers{ INF, 0, 0 };
+		return true;
+	}
+
+	bool orNode = board->sideToMove == attacker;
+
+	// side to move wins next move
+	if (board->find_winning_move(&move)) {
+		if (orNode) {
+			moves->push_back(move);
+			*terminal = { 0, INF, 1 };
+		} else {
+			*terminal = { INF, 0, 0 };
+		}
+
+		return true;
+	}
+
+	board->update_move_sets();
+
+	for (Piece* p : board->pieces[board->sideToMove]) {
+		bboard moveBoard = p->moveBoard;
+		u_long scalar;
+
+		while (Bitboard::scan_forward(&scalar, &moveBoard)) {
+			moveBoard ^= Bitboard::SQUARES[scalar];
+			moves->push_back(Move(p->scalar, (u_short) scalar));
+		}
+	}
+
+	// a forced attacker already has few moves, otherwise only forcing moves are kept
+	if (orNode && !board->isSideForced)
+		std::erase_if(*moves, [this](Move m) { return !is_forcing(m); });
+
+	// no moves, or no forcing moves
+	if (moves->empty()) {
+		*terminal = { INF, 0, 0 };
+		return true;
+	}
+
+	return false;
+}
+
+// check if attacker move forces defender: it threatens to take the last watering hole, or scares a defender piece
+// off a watering hole. any other scare forcing the defender only counts once the attacker needs just one more watering hole,
+// as scares are common and would otherwise make most moves forcing
+bool Solver::is_forcing(Move move) {
+	make_move(move);
+
+	bool forcing = board->threatens_win(attacker);
+
+	for (Piece* p : board->pieces[!attacker])
+		forcing |= p->isThreatened && board->wateringHoles[p->scalar];
+
+	if (!forcing && (board->occupancyBySide[attacker] & board->wateringHoles).count() >= NUM_WH_TO_WIN - 1) {
+		board->quick_move_sets();
+		forcing = board->isSideForced;
+	}
+
+	unmake_move(move);
+
+	return forcing;
+}
+
+// numbers of child after move, from table
+// a repetition of a position on the path is not a win
+ProofNumbers Solver::child_numbers(Move move) {
+	ProofNumbers numbers;
+
+	make_move(move);
+
+	if (std::find(path.begin(), path.end(), board->ttKey) != path.end()) {
+		numbers = { INF, 0, 0 };
+	} else {
+		lookup(&numbers);
+	}
+
+	unmake_move(move);
+
+	return numbers;
+}
+
+// numbers of position from its children
+// best: most-proving child. second: its proof (OR) or disproof (AND) number if best were removed
+ProofNumbers Solver::combine(bool orNode, const vector<ProofNumbers>& children, int* best, u_long* second) {
+	ProofNumbers numbers = { 0, 0, 0 };
+	u_long bestNumber = INF + 1;
+	*best = 0;
+	*second = INF;
+
+	// OR takes the least proof number and the sum of disproof numbers, AND the reverse
+	// a proven OR wins by its shortest proof, a proven AND loses by its longest
+	if (orNode)
+		numbers.pn = INF;
+	else
+		numbers.dn = INF;
+
+	u_short dist = orNode ? USHRT_MAX : 0;
+
+	for (size_t i = 0; i < children.size(); i ++) {
+		const ProofNumbers& c = children[i];
+		u_long n = orNode ? c.pn : c.dn;
+
+		if (orNode) {
+			numbers.pn = (std::min)(numbers.pn, c.pn);
+			numbers.dn = add(numbers.dn, c.dn);
+
+			if (c.pn == 0)
+				dist = (std::min)(dist, c.dist);
+		} else {
+			numbers.pn = add(numbers.pn, c.pn);
+			numbers.dn = (std::min)(numbers.dn, c.dn);
+			dist = (std::max)(dist, c.dist);
+		}
+
+		if (n < bestNumber) {
+			*second = (std::min)(bestNumber, INF);
+			bestNumber = n;
+			*best = (int) i;
+		} else if (n < *second) {
+			*second = n;
+		}
+	}
+
+	if (numbers.pn == 0)
+		numbers.dist = dist + 1;
+
+	return numbers;
+}
+
+// follow proof from root, attacker taking its shortest win and defender its longest defence
+// stops early if a proven position was since replaced in the table
+void Solver::proof_line(LineVector* line) {
+	vector<Move> played;
+
+	while ((int) played.size() < MAX_PLIES) {
+		vector<Move> moves;
+		ProofNumbers terminal;
+
+		// winning move ends line, and is not played
+		if (generate(&moves, &terminal)) {
+			if (terminal.pn == 0 && !moves.empty())
+				line->append(moves[0]);
+
+			break;
+		}
+
+		bool orNode = board->sideToMove == attacker;
+		Move next;
+		bool found = false;
+		u_short dist = 0;
+
+		for (Move m : moves) {
+			ProofNumbers c = child_numbers(m);
+
+			if (c.pn != 0)
+				continue;
+
+			if (!found || (orNode ? c.dist < dist : c.dist > dist)) {
+				next = m;
+				dist = c.dist;
+				found = true;
+			}
+		}
+
+		if (!found)
+			break;
+
+		line->append(next);
+		played.push_back(next);
+		make_move(next);
+	}
+
+	// back to root
+	for (int i = (int) played.size() - 1; i >= 0; i --)
+		unmake_move(played[i]);
+}
+
+////
+
+// look up numbers of position
+// returns false, leaving result as is, if not found
+bool Solver::lookup(ProofNumbers* result) {
+	SolverEntry* entries = bucket();
+
+	for (int i = 0; i < 2; i ++) {
+		if (entries[i].work > 0 && entries[i].key == board->ttKey) {
+			*result = entries[i].numbers;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+// store numbers of position, replacing its own entry, or the entry of its bucket with less work
+void Solver::store(const ProofNumbers& numbers, u_long work) {
+	SolverEntry* entries = bucket();
+	SolverEntry* e = &entries[0];
+
+	if (entries[1].key == board->ttKey || (entries[0].key != board->ttKey && entries[1].work < entries[0].work))
+		e = &entries[1];
+
+	e->key = board->ttKey;
+	e->numbers = numbers;
+	e->work = (std::max)(work, (u_long) 1);
+}
+
+// two entries of position
+SolverEntry* Solver::bucket() {
+	return &table[board->ttHash & tableMask & ~1UL];
+}
+
+////
+
+void Solver::make_move(Move move) {
+	board->move_piece(board->pointerBoard[move.get_from()], move.get_to());
+}
+
+// make_move with 'from' and 'to' reversed
+void Solver::unmake_move(Move move) {
+	board->move_piece(board->pointerBoard[move.get_to()], move.get_from());
+}
+
+////
+
+// check node and time limits, every 4096 nodes
+// returns true once search is to be aborted
+bool Solver::check_limits() {
+	if (aborted || (nodes & 4095) != 0)
+		return aborted;
+
+	if (NODE_LIMIT > 0 && nodes >= NODE_LIMIT)
+		aborted = true;
+
+	if (TIME_LIMIT > 0 && std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startClock).count() > TIME_LIMIT)
+		aborted = true;
+
+	return aborted;
+}
+
+// sum of proof or disproof numbers, INF if either is. otherwise saturates below INF, as the position is not solved
+u_long Solver::add(u_long a, u_long b) {
+	if (a >= INF || b >= INF)
+		return INF;
+
+	return (std::min)(a + b, INF - 1);
+}
+
+} // end namespace Bbot2
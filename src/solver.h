@@ -0,0 +1,110 @@
+// solver.h
+
+// proof-number solver, proves or disproves a forced win for the side to move
+// df-pn: depth-first proof-number search. the most-proving node is expanded under proof and disproof thresholds,
+// so no tree is kept, only the numbers of searched positions, in a fixed size table
+
+// the attacker is the side to move at the root. at attacker nodes (OR) only forcing moves are searched: moves that threaten
+// to take the last watering hole, or scare a defender piece off a watering hole, so it is forced to move, and once the
+// attacker needs just one more watering hole, any move forcing the defender (isSideForced) by a scare.
+// a forced attacker searches its legal moves, which are already few. the defender (AND) searches every legal move,
+// and a forced defender only has the moves of its forced pieces
+// so a proof is a forcing win against every defence, and a disproof only shows there is no forcing win
+
+// a repetition on the current path, or a line of MAX_PLIES, is not a win. proofs never depend on these,
+// disproofs may, and are stored all the same
+
+#pragma once
+
+#include "common.h"
+#include "log.h"
+#include "board.h"
+#include "line.h"
+#include <chrono>
+
+namespace Bbot2 {
+
+enum SolveResult : int { SOLVE_UNKNOWN, SOLVE_WIN, SOLVE_NO_WIN };
+
+typedef struct ProofNumbers {
+	u_long pn = 1; // proof number, 0 if proven
+	u_long dn = 1; // disproof number, 0 if disproven
+	u_short dist = 0; // plies to win, if proven
+} ProofNumbers;
+
+// position searched, stored under its tt key
+// numbers are of the attacker of the solve that stored them, see Solver::solve
+typedef struct SolverEntry {
+	Key key;
+	ProofNumbers numbers;
+	u_long work = 0; // nodes searched below position, 0 if empty. entries with less work are replaced first
+} SolverEntry;
+
+// result of a solve
+typedef struct Solution {
+	SolveResult result = SOLVE_UNKNOWN; // unknown if a limit was reached
+	LineVector line; // proof line if won, to the winning move
+	unsigned __int64 nodes = 0;
+	double time = 0; // seconds
+} Solution;
+
+class Solver {
+public:
+	////
+
+	//// SETTINGS ////
+
+	u_long TABLE_ALLOC = 1 << 20; // entries, rounded up to 2^n. SolverEntry is 32 bytes
+	int MAX_PLIES = 64; // longest line searched
+	unsigned __int64 NODE_LIMIT = 0; // 0 for none
+	long long TIME_LIMIT = 0; // ms, 0 for none
+
+	// usually overrided by .ini in settings()
+
+	////
+
+	static constexpr u_long INF = 1 << 30; // proof or disproof number of a solved position
+
+private:
+	Board* board;
+	Side attacker = WHITE;
+
+	SolverEntry* table = nullptr;
+	u_long tableMask = 0;
+
+	std::vector<Key> path; // tt keys of positions from root to current, for repetitions
+
+	unsigned __int64 nodes = 0;
+	std::chrono::steady_clock::time_point startClock;
+	bool aborted = false;
+
+public:
+	Solver(Board* board_);
+
+	void settings(CSimpleIniA* config);
+	void init();
+
+	Solution solve();
+
+	void close();
+
+private:
+	void search(u_long thpn, u_long thdn, ProofNumbers* result);
+	bool generate(std::vector<Move>* moves, ProofNumbers* terminal);
+	bool is_forcing(Move move);
+	ProofNumbers child_numbers(Move move);
+	ProofNumbers combine(bool orNode, const std::vector<ProofNumbers>& children, int* best, u_long* second);
+	void proof_line(LineVector* line);
+
+	bool lookup(ProofNumbers* result);
+	void store(const ProofNumbers& numbers, u_long work);
+	SolverEntry* bucket();
+
+	void make_move(Move move);
+	void unmake_move(Move move);
+
+	bool check_limits();
+	static u_long add(u_long a, u_long b);
+};
+
+} // end namespace Bbot2
@@ -8,26 +8,23 @@ namespace Bbot2 {
 
 namespace Tables {
 
-// allocate, generate all tables
+// generate all tables, once per process
+// safe to call from several threads, all callers return once tables are generated
 void init() {
-	// allocate sight tables
-	rowSight = new bboard * [OCC_SIZE];
-	fileSight = new bboard * [OCC_SIZE];
+	std::call_once(initialized, generate);
+}
 
-	for (int i = 0; i < OCC_SIZE; i ++) {
-		rowSight[i] = new bboard[BOARD_SIZE];
-		fileSight[i] = new bboard[BOARD_SIZE];
-	}
+// generate all tables
+void generate() {
+	Bitboard::init();
 
-	// generate tables
 	gen_rook_tables();
 	gen_bishop_tables();
+	gen_empty_sight_table();
 	gen_sight_tables();
 	gen_adjacency_table();
 
 	gen_zobrist_table();
-
-	initialized = true;
 }
 
 // lookup tables rows and files, indexed by scalar position
@@ -102,6 +99,25 @@ void gen_bishop_tables() {
 	}
 }
 
+// lookup table for sight of each piece type on an empty board
+// used to quickly rule out pieces before their real sight is computed
+// requires row/file/diag/antidiag tables
+// table size: 3 * 100 * 16 bytes = 4.8 KB
+void gen_empty_sight_table() {
+	for (int i = 0; i < NUM_SQUARES; i ++) {
+		bboard rook = rowTable[i] | fileTable[i];
+		bboard bishop = diagTable[i] | antidiagTable[i];
+
+		// cannot see own square
+		rook.set(i, 0);
+		bishop.set(i, 0);
+
+		emptySightTable[MOUSE][i] = rook;
+		emptySightTable[LION][i] = bishop;
+		emptySightTable[ELEPHANT][i] = rook | bishop;
+	}
+}
+
 // lookup tables for sight of pieces
 // - rows/diags/antidiags all map to rowSight, files use fileSight
 // - first index is mask of relevant occupancy line, transformed to first row
@@ -199,25 +215,26 @@ void gen_adjacency_table() {
 	}
 }
 
-void close() {
-	// deallocate sight tables
-	for (int i = 0; i < OCC_SIZE; i ++) {
-		delete[] rowSight[i];
-		delete[] fileSight[i];
-	}
-
-	delete[] rowSight;
-	delete[] fileSight;
-}
-
 // generate table of xor boards used to make zobrist key
-// table size: 6 * 100 * 16 bytes = 9.6 KB
+// mirror table gives the key of the same position mirrored across center files
+// table size: 2 * 6 * 100 * 16 bytes = 19.2 KB
+// fixed seed, so keys are the same on every run and platform, as opening book files are keyed on them
 void gen_zobrist_table() {
+	std::mt19937_64 rng(ZOBRIST_SEED);
+
+	for (int i = 0; i < NUM_HERDS; i ++) {
+		for (int j = 0; j < NUM_SQUARES; j ++) {
+			zobristTable[i][j] = Bitboard::random(rng);
+		}
+	}
+
 	for (int i = 0; i < NUM_HERDS; i ++) {
 		for (int j = 0; j < NUM_SQUARES; j ++) {
-			zobristTable[i][j] = Bitboard::random();
+			zobristMirror[i][j] = zobristTable[i][Bitboard::mirror_scalar(j)];
 		}
 	}
+
+	zobristSide = Bitboard::random(rng);
 }
 
 } // end namespace Tables
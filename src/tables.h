@@ -2,18 +2,21 @@
 
 // lookup tables used for quick move generation
 // zobrist table used for hash key
+// generated once per process by init, which is safe to call from any thread, and read-only afterwards
 
 #pragma once
 
 #include "common.h"
 #include "log.h"
 #include "bitboard.h"
+#include <mutex>
+#include <random>
 
 
 namespace Bbot2 {
 
 namespace Tables {
-	inline bool initialized = false;
+	inline std::once_flag initialized;
 
 	// lookup tables used to find line masks
 	inline bboard rowTable[NUM_SQUARES];
@@ -21,32 +24,37 @@ namespace Tables {
 	inline bboard diagTable[NUM_SQUARES];
 	inline bboard antidiagTable[NUM_SQUARES];
 
+	// all squares a piece type could see from a square on an empty board
+	// [type][scalar]
+	inline bboard emptySightTable[NUM_TYPES][NUM_SQUARES];
+
 	// randomly generated xor boards for [i][] piece herd in [][j] pos
 	// sums to board.key
 	inline Key zobristTable[NUM_HERDS][NUM_SQUARES];
 	inline Key zobristMirror[NUM_HERDS][NUM_SQUARES]; // mirrored across center files
+	inline Key zobristSide; // xor board for side to move
+	inline const unsigned int ZOBRIST_SEED = 0xBA2CA;
 
 	// lookup tables to find piece moves on a line
 	// sight[occupancy of line][position of piece on line]
-	// size of [OCC_SIZE][BOARD_SIZE] on heap
 	inline const int OCC_SIZE = 1 << BOARD_SIZE;
-	inline bboard** rowSight;
-	inline bboard** fileSight;
+	inline bboard rowSight[OCC_SIZE][BOARD_SIZE];
+	inline bboard fileSight[OCC_SIZE][BOARD_SIZE];
 
 	// lookup table to find adjacent squares
 	inline bboard adjacencyTable[NUM_SQUARES];
 
 	void init();
+	void generate();
 
 	void gen_rook_tables();
 	void gen_bishop_tables();
+	void gen_empty_sight_table();
 	void gen_sight_tables();
 	void gen_adjacency_table();
 
 	void gen_zobrist_table();
 
-	void close();
-
 } // end namespace Tables
 
 } // end namespace Bbot2
@@ -0,0 +1,327 @@
+// tournament.cpp
+
+#include "tournament.h"
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+using std::string;
+using std::vector;
+using std::format;
+
+namespace Bbot2 {
+
+// Tournament //
+
+// get settings from .ini
+void Tournament::settings(CSimpleIniA* config) {
+	startPos = string(config->GetValue("GAME", "start-pos", startPos.c_str()));
+
+	MAX_PLIES = (int) config->GetLongValue("TOURNAMENT", "max-plies", MAX_PLIES);
+	RANDOM_OPENING_PLIES = (int) config->GetLongValue("TOURNAMENT", "random-opening-plies", RANDOM_OPENING_PLIES);
+
+	ELO_0 = config->GetDoubleValue("TOURNAMENT", "sprt-elo0", ELO_0);
+	ELO_1 = config->GetDoubleValue("TOURNAMENT", "sprt-elo1", ELO_1);
+	ALPHA = config->GetDoubleValue("TOURNAMENT", "sprt-alpha", ALPHA);
+	BETA = config->GetDoubleValue("TOURNAMENT", "sprt-beta", BETA);
+
+	gamesFile = string(config->GetValue("TOURNAMENT", "games-file", gamesFile.c_str()));
+}
+
+// load engine configuration from .ini file
+// engine: 0 = A, 1 = B
+void Tournament::load_engine(int engine, string filename) {
+	CSimpleIniA* config = &configs[engine];
+
+	config->SetUnicode();
+	config->SetMultiLine(true);
+
+	if (config->LoadFile(filename.c_str()) != SI_OK)
+		throw Exception("Could not load " + filename);
+
+	names[engine] = filename;
+	types[engine] = string(config->GetValue("COMPUTER_PLAYER", "engine", "alphabeta"));
+	maxTime[engine] = (int) config->GetLongValue("COMPUTER_PLAYER", "time-limit", 1000);
+	maxDepth[engine] = (int) config->GetLongValue("COMPUTER_PLAYER", "depth-limit", MAX_LINE_LEN);
+}
+
+// load openings, one line of moves per line of file, e.g. "1. Ld2c3 Ef10j10 2. Me2e4"
+// move numbers are ignored
+void Tournament::load_openings(string filename) {
+	std::ifstream file(filename);
+
+	if (!file)
+		throw Exception("Could not load " + filename);
+
+	// replay each line from the start position to check it is legal
+	Board board;
+	board.DEFAULT_START_POS = startPos;
+	board.init();
+
+	string line, token;
+	int lineNum = 0;
+
+	while (std::getline(file, line)) {
+		vector<Move> opening;
+		std::istringstream tokens(line);
+		lineNum ++;
+
+		board.reset();
+
+		// tokens starting with a piece char are moves
+		while (tokens >> token) {
+			if (string(BOARD_CHARS, NUM_HERDS).find(token[0]) == string::npos)
+				continue;
+
+			Move move(token);
+
+			if (!board.quick_is_legal(move)) {
+				board.close();
+				throw Exception(format("Illegal opening move {} on line {} of {}", token, lineNum, filename));
+			}
+
+			board.move_piece(board.pointerBoard[move.get_from()], move.get_to());
+			board.update_move_sets();
+			opening.push_back(move);
+
+			// opening must leave the game to the engines
+			if ((board.occupancyBySide[!board.sideToMove] & board.wateringHoles).count() >= NUM_WH_TO_WIN) {
+				board.close();
+				throw Exception(format("Opening move {} on line {} of {} ends the game", token, lineNum, filename));
+			}
+		}
+
+		if (!opening.empty())
+			openings.push_back(opening);
+	}
+
+	board.close();
+
+	if (openings.empty())
+		throw Exception("No openings found in " + filename);
+}
+
+////
+
+// play match
+// numGames_: maximum number of games, rounded up to an even number so colours are paired
+void Tournament::run(int numGames_, int numThreads) {
+	numGames = numGames_ + numGames_ % 2;
+
+	if (openings.empty())
+		random_openings(numGames / 2);
+
+	__PRINT(format("{} vs {}: {} games, {} openings, {} threads\n", names[0], names[1], numGames, openings.size(), numThreads));
+	__PRINT(format("SPRT: elo0 = {}, elo1 = {}, alpha = {}, beta = {}\n", ELO_0, ELO_1, ALPHA, BETA));
+
+	if (!gamesFile.empty())
+		games.open(gamesFile);
+
+	vector<std::thread> threads;
+	for (int i = 0; i < numThreads; i ++)
+		threads.push_back(std::thread(&Tournament::worker, this));
+
+	for (std::thread& t : threads)
+		t.join();
+
+	games.close();
+}
+
+// print final results
+void Tournament::print() {
+	int n = wins + draws + losses;
+
+	__PRINT(format("\nFINAL: {} games, +{} ={} -{}\n", n, wins, draws, losses));
+
+	if (n > 0) {
+		// 95% confidence interval from variance of a single game's score
+		double x = score();
+		double var = ((wins + draws / 4.0) / n - x * x) / n;
+		double margin = 1.96 * std::sqrt((std::max)(var, 0.0));
+
+		__PRINT(format("ELO: {:+.1f} (95%: {:+.1f} to {:+.1f})\n", elo(x), elo(x - margin), elo(x + margin)));
+		__PRINT(format("LLR: {:.3f} ({:.3f}, {:.3f})\n", llr(), std::log(BETA / (1 - ALPHA)), std::log((1 - BETA) / ALPHA)));
+	}
+
+	const string SPRT_NAMES[3] = { "no result", "H0 accepted", "H1 accepted" };
+	__PRINT("SPRT: " + SPRT_NAMES[sprt] + "\n");
+}
+
+////
+
+// generate count openings of random legal moves from the start position
+// seeded, so runs with the same settings play the same openings
+void Tournament::random_openings(int count) {
+	Board board;
+	board.DEFAULT_START_POS = startPos;
+	board.init();
+
+	std::mt19937 rng(count);
+	Move move;
+
+	for (int i = 0; i < count; i ++) {
+		board.reset();
+		vector<Move> opening;
+
+		for (int ply = 0; ply < RANDOM_OPENING_PLIES; ply ++) {
+			if (!board.random_move(rng, &move))
+				break;
+
+			board.move_piece(board.pointerBoard[move.get_from()], move.get_to());
+			board.update_move_sets();
+			opening.push_back(move);
+
+			// stop before opening decides game
+			if ((board.occupancyBySide[!board.sideToMove] & board.wateringHoles).count() >= NUM_WH_TO_WIN - 1)
+				break;
+		}
+
+		openings.push_back(opening);
+	}
+
+	board.close();
+}
+
+// play games until none remain or SPRT has stopped the match
+void Tournament::worker() {
+	try {
+
+	Board board;
+	board.DEFAULT_START_POS = startPos;
+	board.init();
+
+	Game game(&board);
+	game.init();
+
+	Engine* comp[NUM_ENGINES];
+
+	for (int i = 0; i < NUM_ENGINES; i ++) {
+		comp[i] = create_engine(types[i], &game);
+		comp[i]->settings(&configs[i]);
+		comp[i]->init();
+	}
+
+	int n;
+	while (!stopped && (n = nextGame ++) < numGames) {
+		vector<Move>& opening = openings[(n / 2) % openings.size()];
+		Side sideA = SIDES[n % 2]; // A plays white in even games, black in odd
+
+		game.reset();
+		game.add_player(comp[sideA], WHITE);
+		game.add_player(comp[!sideA], BLACK);
+
+		for (int i = 0; i < NUM_ENGINES; i ++)
+			comp[i]->attach_game(&game);
+
+		// opening, checked legal by load_openings or random_openings
+		for (Move m : opening)
+			game.play_move(m);
+
+		while (!game.game_over()) {
+			if (game.ply >= MAX_PLIES) {
+				game.outcome = DRAW_MOVE_LIMIT;
+				break;
+			}
+
+			// index of engine to move
+			int e = board.sideToMove == sideA ? 0 : 1;
+
+			while (comp[e]->search(maxTime[e], maxDepth[e]));
+			Move move = comp[e]->suggested_move();
+
+			// an illegal or null move loses, rather than throwing from play_move and ending the worker
+			if (!board.quick_is_legal(move)) {
+				__PRINT(format("{} suggested illegal move {} at ply {}, scored as a loss\n", names[e], board.move_to_string(move), game.ply));
+				game.outcome = board.sideToMove ? WIN_WHITE : WIN_BLACK;
+				break;
+			}
+
+			game.play_move(move);
+		}
+
+		add_result(&game, sideA);
+	}
+
+	for (int i = 0; i < NUM_ENGINES; i ++) {
+		comp[i]->close();
+		delete comp[i];
+	}
+
+	game.close();
+	board.close();
+
+	} catch (Exception e) {
+		e.print();
+	}
+}
+
+// record result of a game, then test if match can be stopped
+void Tournament::add_result(Game* game, Side sideA) {
+	std::lock_guard<std::mutex> guard(lock);
+
+	Outcome outcome = game->outcome;
+
+	if (!gamesFile.empty())
+		games.write(game);
+
+	if (outcome == WIN_WHITE || outcome == WIN_BLACK) {
+		bool winA = (outcome == WIN_WHITE) == (sideA == WHITE);
+		winA ? wins ++ : losses ++;
+	} else {
+		draws ++;
+	}
+
+	int n = wins + draws + losses;
+	double l = llr();
+
+	if (sprt == SPRT_NONE) {
+		if (l >= std::log((1 - BETA) / ALPHA)) {
+			sprt = SPRT_H1;
+		} else if (l <= std::log(BETA / (1 - ALPHA))) {
+			sprt = SPRT_H0;
+		}
+
+		if (sprt != SPRT_NONE)
+			stopped = true;
+	}
+
+	if (n % 10 == 0 || stopped)
+		__PRINT(format("GAME {}: +{} ={} -{}, ELO {:+.1f}, LLR {:.3f}\n", n, wins, draws, losses, elo(score()), l));
+}
+
+////
+
+// mean score of engine A
+double Tournament::score() {
+	int n = wins + draws + losses;
+	return n > 0 ? (wins + draws / 2.0) / n : 0.5;
+}
+
+// elo difference from mean score x
+double Tournament::elo(double x) {
+	x = std::clamp(x, 1e-6, 1 - 1e-6);
+	return -400 * std::log10(1 / x - 1);
+}
+
+// log-likelihood ratio of H1 to H0
+// generalized SPRT, approximating the trinomial (win/draw/loss) distribution by its mean and variance
+double Tournament::llr() {
+	int n = wins + draws + losses;
+
+	if (n == 0 || wins + draws == 0 || draws + losses == 0)
+		return 0;
+
+	double x = score();
+	double var = (wins + draws / 4.0) / n - x * x;
+
+	if (var <= 0)
+		return 0;
+
+	// expected scores under each hypothesis
+	double s0 = 1 / (1 + std::pow(10, -ELO_0 / 400));
+	double s1 = 1 / (1 + std::pow(10, -ELO_1 / 400));
+
+	return (s1 - s0) * (2 * x - s0 - s1) / (2 * var / n);
+}
+
+} // end namespace Bbot2
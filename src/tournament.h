@@ -0,0 +1,97 @@
+// tournament.h
+
+// headless engine-vs-engine match, played concurrently on several threads
+// each engine is configured by its own .ini file, read like SETTINGS.ini (COMPUTER_PLAYER and EVALUATION sections)
+// its type is 'engine' in COMPUTER_PLAYER, alphabeta by default or mcts, see engine.h
+// every worker thread owns one board, one game, and an instance of each engine
+
+// every opening is played twice with colours swapped, so an unbalanced opening favours neither engine
+// openings are lines of moves from the start position, one per line of a text file, or random if no file is given
+
+// after every game, a sequential probability ratio test (SPRT) checks whether engine A is ELO_0 (H0) or ELO_1 (H1) stronger than B
+// the match stops as soon as either hypothesis is accepted, or once all games are played
+
+// games are appended to a games file if one is set, see gamedb.h
+
+#pragma once
+
+#include "common.h"
+#include "log.h"
+#include "board.h"
+#include "game.h"
+#include "engine.h"
+#include "gamedb.h"
+#include <atomic>
+#include <mutex>
+
+namespace Bbot2 {
+
+const int NUM_ENGINES = 2;
+
+enum SPRTResult : int { SPRT_NONE, SPRT_H0, SPRT_H1 };
+
+class Tournament {
+public:
+	////
+
+	//// SETTINGS ////
+
+	int MAX_PLIES = 300; // game is declared a draw after this many plies
+	int RANDOM_OPENING_PLIES = 6; // length of random openings, used if no openings file is given
+
+	// SPRT
+	double ELO_0 = 0; // null hypothesis, A is not stronger
+	double ELO_1 = 5; // alternative hypothesis, A is stronger by at least this much
+	double ALPHA = 0.05; // false positive rate
+	double BETA = 0.05; // false negative rate
+
+	std::string startPos = Board().DEFAULT_START_POS;
+	std::string gamesFile = ""; // no games are saved if empty
+
+	// usually overrided by .ini in settings()
+
+	////
+
+private:
+	// engines
+	std::string names[NUM_ENGINES];
+	std::string types[NUM_ENGINES]; // see create_engine
+	CSimpleIniA configs[NUM_ENGINES];
+	int maxTime[NUM_ENGINES]; // ms per move
+	int maxDepth[NUM_ENGINES];
+
+	std::vector<std::vector<Move>> openings;
+
+	// games
+	int numGames = 0;
+	std::atomic<int> nextGame = 0;
+	std::atomic<bool> stopped = false;
+
+	// results from engine A's perspective, guarded by lock
+	std::mutex lock;
+	int wins = 0;
+	int draws = 0;
+	int losses = 0;
+	SPRTResult sprt = SPRT_NONE;
+	GameWriter games; // if gamesFile is set
+
+public:
+	void settings(CSimpleIniA* config);
+
+	void load_engine(int engine, std::string filename);
+	void load_openings(std::string filename);
+
+	void run(int numGames_, int numThreads);
+	void print();
+
+private:
+	void random_openings(int count);
+	void worker();
+	void add_result(Game* game, Side sideA);
+
+	double score();
+	double elo(double x);
+	double llr();
+};
+
+} // end namespace Bbot2
@@ -0,0 +1,674 @@
+// tuner.cpp
+
+#include "tuner.h"
+#include <fstream>
+#include <thread>
+#include <functional>
+#include <numeric>
+#include <cmath>
+
+using std::string;
+using std::vector;
+using std::format;
+
+namespace Bbot2 {
+
+// run f(begin, end, thread index) over numSamples split into one slice per thread
+static void run_slices(size_t numSamples, int numThreads, std::function<void(size_t, size_t, int)> f) {
+	vector<std::thread> threads;
+	size_t sliceSize = (numSamples + numThreads - 1) / numThreads;
+
+	for (int t = 0; t < numThreads; t ++) {
+		size_t begin = (std::min)(numSamples, t * sliceSize);
+		size_t end = (std::min)(numSamples, begin + sliceSize);
+		threads.push_back(std::thread(f, begin, end, t));
+	}
+
+	for (std::thread& t : threads)
+		t.join();
+}
+
+// Tuner //
+
+// constructor
+// config: .ini to start parameters from
+Tuner::Tuner(CSimpleIniA* config, int numThreads_)
+	: numThreads(numThreads_) {
+
+	// get parameters and their current values from an unattached engine
+	Board board;
+	Game game(&board);
+	Bbot comp(&game);
+	comp.settings(config);
+
+	paramList = comp.eval_params();
+	numParams = (int) paramList.size();
+
+	for (EvalParam& param : paramList) {
+		params.push_back(*param.value);
+		param.value = nullptr;
+	}
+}
+
+////
+
+// play self-play games and append their quiet positions to a dataset file
+// config: .ini for start position and engine settings
+void Tuner::generate(string filename, CSimpleIniA* config, int numGames, int maxDepth, int numThreads) {
+	vector<TuneSample> samples;
+	std::mutex lock;
+	std::atomic<int> gamesLeft = numGames;
+
+	vector<std::thread> threads;
+	for (int i = 0; i < numThreads; i ++)
+		threads.push_back(std::thread(gen_worker, &samples, &lock, &gamesLeft, config, maxDepth, (unsigned int) (std::random_device()() + i)));
+
+	for (std::thread& t : threads)
+		t.join();
+
+	std::ofstream file(filename, std::ios::binary | std::ios::app);
+
+	if (!file)
+		throw Exception("Could not write " + filename);
+
+	file.write(reinterpret_cast<const char*>(samples.data()), samples.size() * sizeof(TuneSample));
+
+	__PRINT(format("{} games played, {} positions appended to {}\n", numGames, samples.size(), filename));
+}
+
+// play self-play games until none remain, adding quiet positions of each game to samples
+// each thread has its own board, game, and engines
+void Tuner::gen_worker(vector<TuneSample>* samples, std::mutex* lock, std::atomic<int>* gamesLeft, CSimpleIniA* config, int maxDepth, unsigned int seed) {
+
+	try {
+
+	Board board;
+	board.settings(config);
+	board.init();
+
+	Game game(&board);
+	game.init();
+
+	Bbot comp[NUM_SIDES] = { Bbot(&game), Bbot(&game) };
+
+	for (Side side : SIDES) {
+		comp[side].settings(config);
+		comp[side].init();
+		game.add_player(&comp[side], side);
+	}
+
+	std::mt19937 rng(seed);
+	vector<TuneSample> gameSamples;
+	Move move;
+
+	while ((*gamesLeft) -- > 0) {
+		game.reset();
+		for (Side side : SIDES)
+			comp[side].attach_game(&game);
+
+		gameSamples.clear();
+
+		while (!game.game_over() && game.ply < GEN_MAX_PLIES) {
+
+			// random opening moves
+			if (game.ply < GEN_RANDOM_PLIES && board.random_move(rng, &move)) {
+				game.play_move(move);
+				continue;
+			}
+
+			Bbot* c = &comp[board.sideToMove];
+			while (c->search(INT_MAX, maxDepth));
+
+			// quiet positions only
+			if (!board.isSideForced && !c->is_mate_eval(c->search_value())
+				&& !board.threatens_win(WHITE) && !board.threatens_win(BLACK))
+				gameSamples.push_back(sample_of(&board));
+
+			game.play_move(c->suggested_move());
+		}
+
+		u_byte result = game.outcome == WIN_WHITE ? 2 : game.outcome == WIN_BLACK ? 0 : 1;
+
+		for (TuneSample& sample : gameSamples)
+			sample.result = result;
+
+		std::lock_guard<std::mutex> guard(*lock);
+		samples->insert(samples->end(), gameSamples.begin(), gameSamples.end());
+	}
+
+	for (Side side : SIDES)
+		comp[side].close();
+
+	game.close();
+	board.close();
+
+	} catch (Exception e) {
+		e.print();
+	}
+}
+
+// read dataset file and reduce every sample to its features
+void Tuner::load(string filename) {
+	std::ifstream file(filename, std::ios::binary | std::ios::ate);
+
+	if (!file)
+		throw Exception("Could not load " + filename);
+
+	numSamples = (size_t) file.tellg() / sizeof(TuneSample);
+	file.seekg(0);
+
+	vector<TuneSample> samples(numSamples);
+	file.read(reinterpret_cast<char*>(samples.data()), numSamples * sizeof(TuneSample));
+
+	features.assign(numSamples * numParams, 0);
+	base.assign(numSamples, 0);
+	results.assign(numSamples, 0);
+
+	run_slices(numSamples, numThreads, [&](size_t begin, size_t end, int t) {
+		try {
+
+		Board board;
+		board.init();
+
+		Game game(&board);
+		game.init();
+
+		// evaluators[0] has all parameters at 0, evaluators[i + 1] has only parameter i at 1
+		// evaluators only use their value tables, so are not initialized
+		vector<Bbot> evaluators(numParams + 1, Bbot(&game));
+
+		for (int i = 0; i <= numParams; i ++) {
+			vector<EvalParam> p = evaluators[i].eval_params();
+
+			for (int j = 0; j < numParams; j ++)
+				*p[j].value = (j + 1 == i);
+
+			evaluators[i].init_eval_boards();
+		}
+
+		for (size_t s = begin; s < end; s ++) {
+			board.unpack(samples[s].position, SIDES[samples[s].sideToMove]);
+			int sign = board.sideToMove ? -1 : 1;
+
+			int value = sign * evaluators[0].evaluate();
+			base[s] = (float) value;
+
+			for (int i = 0; i < numParams; i ++)
+				features[s * numParams + i] = (float) (sign * evaluators[i + 1].evaluate() - value);
+
+			results[s] = samples[s].result / 2.0f;
+		}
+
+		board.close();
+
+		} catch (Exception e) {
+			e.print();
+		}
+	});
+
+	__PRINT(format("{} positions loaded from {}\n", numSamples, filename));
+}
+
+// fit parameters to dataset
+void Tuner::fit(int iterations) {
+	if (numSamples == 0)
+		throw Exception("No positions to tune on");
+
+	fit_K();
+	initialLoss = loss(params, K, nullptr);
+
+	__PRINT(format("K = {:.4e}, initial loss = {:.6f}\n", K, initialLoss));
+
+	// Adam
+	vector<double> gradient(numParams);
+	vector<double> m(numParams, 0);
+	vector<double> v(numParams, 0);
+
+	for (int it = 1; it <= iterations; it ++) {
+		double l = loss(params, K, &gradient);
+
+		for (int i = 0; i < numParams; i ++) {
+			m[i] = BETA_1 * m[i] + (1 - BETA_1) * gradient[i];
+			v[i] = BETA_2 * v[i] + (1 - BETA_2) * gradient[i] * gradient[i];
+
+			double mHat = m[i] / (1 - std::pow(BETA_1, it));
+			double vHat = v[i] / (1 - std::pow(BETA_2, it));
+
+			params[i] -= LEARNING_RATE * mHat / (std::sqrt(vHat) + 1e-12);
+		}
+
+		if (it % 100 == 0)
+			__PRINT(format("ITERATION {}: loss = {:.6f}\n", it, l));
+	}
+
+	finalLoss = loss(params, K, nullptr);
+}
+
+// print tuned parameters, as bbot.h constants and as an .ini section
+void Tuner::print() {
+	__PRINT(format("\n// tuned over {} positions, loss {:.6f} -> {:.6f}\n", numSamples, initialLoss, finalLoss));
+
+	// group array parameters on one line
+	for (int i = 0; i < numParams; i ++) {
+		EvalParam& param = paramList[i];
+
+		if (param.index < 0) {
+			__PRINT(format("int {} = {};\n", param.name, (int) std::round(params[i])));
+			continue;
+		}
+
+		if (param.index != 0)
+			continue;
+
+		int len = 0;
+		string values;
+
+		while (i + len < numParams && paramList[i + len].name == param.name) {
+			values += (len ? ", " : "") + std::to_string((int) std::round(params[i + len]));
+			len ++;
+		}
+
+		__PRINT(format("int {}[{}] = ", param.name, len) + "{ " + values + " };\n");
+	}
+
+	__PRINT("\n[EVALUATION]\n");
+
+	for (int i = 0; i < numParams; i ++)
+		__PRINT(format("{} = {}\n", paramList[i].ini_key(), (int) std::round(params[i])));
+}
+
+////
+
+// mean logistic loss of parameters w with scaling k
+// if gradient is not nullptr, it is set to the gradient of the loss with respect to w
+double Tuner::loss(vector<double>& w, double k, vector<double>* gradient) {
+	vector<double> threadLoss(numThreads, 0);
+	vector<vector<double>> threadGradient(numThreads, vector<double>(numParams, 0));
+
+	run_slices(numSamples, numThreads, [&](size_t begin, size_t end, int t) {
+		double l = 0;
+		vector<double>& g = threadGradient[t];
+
+		for (size_t s = begin; s < end; s ++) {
+			const float* f = &features[s * numParams];
+
+			double e = base[s];
+			for (int i = 0; i < numParams; i ++)
+				e += w[i] * f[i];
+
+			double p = 1 / (1 + std::exp(-k * e));
+			p = std::clamp(p, 1e-9, 1 - 1e-9);
+
+			double r = results[s];
+			l -= r * std::log(p) + (1 - r) * std::log(1 - p);
+
+			if (gradient == nullptr)
+				continue;
+
+			double d = (p - r) * k;
+			for (int i = 0; i < numParams; i ++)
+				g[i] += d * f[i];
+		}
+
+		threadLoss[t] = l;
+	});
+
+	double total = 0;
+	for (int t = 0; t < numThreads; t ++)
+		total += threadLoss[t];
+
+	if (gradient != nullptr) {
+		gradient->assign(numParams, 0);
+
+		for (int t = 0; t < numThreads; t ++)
+			for (int i = 0; i < numParams; i ++)
+				(*gradient)[i] += threadGradient[t][i] / numSamples;
+	}
+
+	return total / numSamples;
+}
+
+// find K minimizing loss of current parameters
+// coarse scan over powers of 10, then refined around the best
+void Tuner::fit_K() {
+	double best = 0;
+	double bestLoss = 0;
+	double step = 0.1;
+
+	for (double x = -8; x <= -2; x += step) {
+		double l = loss(params, std::pow(10, x), nullptr);
+
+		if (best == 0 || l < bestLoss) {
+			best = x;
+			bestLoss = l;
+		}
+	}
+
+	for (double x = best - step; x <= best + step; x += step / 20) {
+		double l = loss(params, std::pow(10, x), nullptr);
+
+		if (l < bestLoss) {
+			best = x;
+			bestLoss = l;
+		}
+	}
+
+	K = std::pow(10, best);
+}
+
+////
+
+// sample of current position of board, with result unset
+TuneSample Tuner::sample_of(Board* board) {
+	TuneSample sample;
+
+	sample.position = board->pack();
+	sample.sideToMove = board->sideToMove;
+	sample.result = 1;
+
+	return sample;
+}
+
+// NnueTrainer //
+
+// constructor
+// weights start uniformly random, scaled to the number of inputs of each layer
+NnueTrainer::NnueTrainer(int numThreads_, unsigned int seed)
+	: numThreads(numThreads_), rng(seed) {
+
+	params.assign(NUM_PARAMS, 0);
+
+	auto randomize = [this](int begin, int count, float range) {
+		std::uniform_real_distribution<float> dist(-range, range);
+
+		for (int i = 0; i < count; i ++)
+			params[begin + i] = dist(rng);
+	};
+
+	randomize(L1_WEIGHTS, NNUE_FEATURES * NNUE_L1, 1 / std::sqrt((float) NUM_PIECES));
+	randomize(L2_WEIGHTS, NNUE_L2 * 2 * NNUE_L1, 1 / std::sqrt((float) 2 * NNUE_L1));
+	randomize(OUT_WEIGHTS, NNUE_L2, 1 / std::sqrt((float) NNUE_L2));
+}
+
+////
+
+// read dataset file of Tuner::generate, and reduce every sample to its features
+void NnueTrainer::load(string filename) {
+	std::ifstream file(filename, std::ios::binary | std::ios::ate);
+
+	if (!file)
+		throw Exception("Could not load " + filename);
+
+	size_t numSamples = (size_t) file.tellg() / sizeof(TuneSample);
+	file.seekg(0);
+
+	vector<TuneSample> samples(numSamples);
+	file.read(reinterpret_cast<char*>(samples.data()), numSamples * sizeof(TuneSample));
+
+	vector<NnueSample> reduced(numSamples);
+
+	run_slices(numSamples, numThreads, [&](size_t begin, size_t end, int t) {
+		try {
+
+		Board board;
+		board.init();
+
+		int features[NNUE_MAX_ACTIVE];
+
+		for (size_t s = begin; s < end; s ++) {
+			NnueSample& sample = reduced[s];
+			board.unpack(samples[s].position, SIDES[samples[s].sideToMove]);
+
+			for (Side side : SIDES) {
+				sample.numFeatures = (u_byte) Nnue::active_features(&board, side, features);
+
+				for (int i = 0; i < sample.numFeatures; i ++)
+					sample.features[side][i] = (u_short) features[i];
+			}
+
+			sample.sideToMove = SIDES[samples[s].sideToMove];
+			sample.result = sample.sideToMove ? 1 - samples[s].result / 2.0f : samples[s].result / 2.0f;
+		}
+
+		board.close();
+
+		} catch (Exception e) {
+			e.print();
+		}
+	});
+
+	for (size_t s = 0; s < numSamples; s ++)
+		(s % VALIDATION_SHARE == 0 ? validation : training).push_back(reduced[s]);
+
+	__PRINT(format("{} positions loaded from {}, {} held out\n", numSamples, filename, validation.size()));
+}
+
+// train on shuffled minibatches for a number of passes over the training samples
+void NnueTrainer::train(int epochs) {
+	if (training.empty())
+		throw Exception("No positions to train on");
+
+	vector<float> gradient;
+	vector<float> m(NUM_PARAMS, 0);
+	vector<float> v(NUM_PARAMS, 0);
+
+	vector<size_t> order(training.size());
+	std::iota(order.begin(), order.end(), 0);
+
+	int step = 0;
+
+	for (int epoch = 1; epoch <= epochs; epoch ++) {
+		std::shuffle(order.begin(), order.end(), rng);
+		double total = 0;
+
+		for (size_t b = 0; b < order.size(); b += BATCH_SIZE) {
+			size_t count = (std::min)((size_t) BATCH_SIZE, order.size() - b);
+			total += loss(training, &order[b], count, &gradient) * count;
+
+			// Adam
+			step ++;
+			float c1 = 1 - std::pow(BETA_1, (float) step);
+			float c2 = 1 - std::pow(BETA_2, (float) step);
+
+			for (int i = 0; i < NUM_PARAMS; i ++) {
+				m[i] = BETA_1 * m[i] + (1 - BETA_1) * gradient[i];
+				v[i] = BETA_2 * v[i] + (1 - BETA_2) * gradient[i] * gradient[i];
+
+				params[i] -= LEARNING_RATE * (m[i] / c1) / (std::sqrt(v[i] / c2) + 1e-8f);
+			}
+
+			// second layer weights must fit in int8 once quantized
+			for (int i = L2_WEIGHTS; i < OUT_BIAS; i ++)
+				params[i] = std::clamp(params[i], -128.0f / NNUE_QB, 127.0f / NNUE_QB);
+		}
+
+		double validationLoss = validation.empty() ? 0 : loss(validation, nullptr, validation.size(), nullptr);
+		__PRINT(format("EPOCH {}: loss = {:.6f}, validation loss = {:.6f}\n", epoch, total / order.size(), validationLoss));
+	}
+}
+
+// quantize network and write it to file
+void NnueTrainer::save(string filename) {
+	std::unique_ptr<Nnue> network = std::make_unique<Nnue>();
+	quantize(network.get());
+	network->save(filename);
+
+	if (!validation.empty())
+		__PRINT(format("validation loss = {:.6f}, quantized = {:.6f}\n", loss(validation, nullptr, validation.size(), nullptr), quantized_loss(*network)));
+
+	__PRINT(format("Network saved to {}\n", filename));
+}
+
+////
+
+// mean loss over count samples, in given order or in sequence if order is nullptr
+// if gradient is not nullptr, it is set to the mean gradient of the loss with respect to params
+double NnueTrainer::loss(const vector<NnueSample>& samples, const size_t* order, size_t count, vector<float>* gradient) {
+	vector<double> threadLoss(numThreads, 0);
+	vector<vector<float>> threadGradient(gradient ? numThreads : 0, vector<float>(NUM_PARAMS, 0));
+
+	run_slices(count, numThreads, [&](size_t begin, size_t end, int t) {
+		float* g = gradient ? threadGradient[t].data() : nullptr;
+		double l = 0;
+
+		for (size_t i = begin; i < end; i ++)
+			l += forward(samples[order ? order[i] : i], g);
+
+		threadLoss[t] = l;
+	});
+
+	double total = 0;
+	for (int t = 0; t < numThreads; t ++)
+		total += threadLoss[t];
+
+	if (gradient != nullptr) {
+		gradient->assign(NUM_PARAMS, 0);
+
+		for (int t = 0; t < numThreads; t ++)
+			for (int i = 0; i < NUM_PARAMS; i ++)
+				(*gradient)[i] += threadGradient[t][i] / count;
+	}
+
+	return total / count;
+}
+
+// logistic loss of network output for sample, against its result
+// if gradient is not nullptr, the gradient of the loss is added to it by backpropagation
+float NnueTrainer::forward(const NnueSample& sample, float* gradient) {
+	const float* w = params.data();
+
+	// first layer, side to move first, then clipped relu
+	float z1[2][NNUE_L1];
+	float x[2 * NNUE_L1];
+
+	for (int h = 0; h < 2; h ++) {
+		Side side = SIDES[h == 0 ? sample.sideToMove : !sample.sideToMove];
+		std::copy(w + L1_BIAS, w + L1_BIAS + NNUE_L1, z1[h]);
+
+		for (int i = 0; i < sample.numFeatures; i ++) {
+			const float* row = w + L1_WEIGHTS + sample.features[side][i] * NNUE_L1;
+
+			for (int j = 0; j < NNUE_L1; j ++)
+				z1[h][j] += row[j];
+		}
+
+		for (int j = 0; j < NNUE_L1; j ++)
+			x[h * NNUE_L1 + j] = std::clamp(z1[h][j], 0.0f, 1.0f);
+	}
+
+	// second layer, then output
+	float z2[NNUE_L2];
+	float out = w[OUT_BIAS];
+
+	for (int i = 0; i < NNUE_L2; i ++) {
+		const float* row = w + L2_WEIGHTS + i * 2 * NNUE_L1;
+		z2[i] = w[L2_BIAS + i];
+
+		for (int j = 0; j < 2 * NNUE_L1; j ++)
+			z2[i] += row[j] * x[j];
+
+		out += w[OUT_WEIGHTS + i] * std::clamp(z2[i], 0.0f, 1.0f);
+	}
+
+	float p = std::clamp(1 / (1 + std::exp(-out)), 1e-7f, 1 - 1e-7f);
+	float r = sample.result;
+	float l = -(r * std::log(p) + (1 - r) * std::log(1 - p));
+
+	if (gradient == nullptr)
+		return l;
+
+	// backpropagation, through clipped relus only where they are not clipped
+	float d = p - r;
+	float dx[2 * NNUE_L1] = {};
+
+	gradient[OUT_BIAS] += d;
+
+	for (int i = 0; i < NNUE_L2; i ++) {
+		gradient[OUT_WEIGHTS + i] += d * std::clamp(z2[i], 0.0f, 1.0f);
+
+		if (z2[i] <= 0 || z2[i] >= 1)
+			continue;
+
+		float dz = d * w[OUT_WEIGHTS + i];
+		const float* row = w + L2_WEIGHTS + i * 2 * NNUE_L1;
+		float* g = gradient + L2_WEIGHTS + i * 2 * NNUE_L1;
+
+		gradient[L2_BIAS + i] += dz;
+
+		for (int j = 0; j < 2 * NNUE_L1; j ++) {
+			g[j] += dz * x[j];
+			dx[j] += dz * row[j];
+		}
+	}
+
+	for (int h = 0; h < 2; h ++) {
+		Side side = SIDES[h == 0 ? sample.sideToMove : !sample.sideToMove];
+		float dz[NNUE_L1];
+
+		for (int j = 0; j < NNUE_L1; j ++) {
+			dz[j] = (z1[h][j] > 0 && z1[h][j] < 1) ? dx[h * NNUE_L1 + j] : 0;
+			gradient[L1_BIAS + j] += dz[j];
+		}
+
+		for (int i = 0; i < sample.numFeatures; i ++) {
+			float* g = gradient + L1_WEIGHTS + sample.features[side][i] * NNUE_L1;
+
+			for (int j = 0; j < NNUE_L1; j ++)
+				g[j] += dz[j];
+		}
+	}
+
+	return l;
+}
+
+// mean loss of quantized network over validation samples, evaluated as in search
+double NnueTrainer::quantized_loss(const Nnue& network) {
+	double total = 0;
+	NnueAccumulator acc;
+
+	for (const NnueSample& sample : validation) {
+		for (Side side : SIDES) {
+			std::copy(network.l1Bias, network.l1Bias + NNUE_L1, acc.values[side]);
+
+			for (int i = 0; i < sample.numFeatures; i ++)
+				for (int j = 0; j < NNUE_L1; j ++)
+					acc.values[side][j] += network.l1Weights[sample.features[side][i]][j];
+		}
+
+		double p = 1 / (1 + std::exp(-(double) network.evaluate(acc, sample.sideToMove) / NNUE_EVAL_UNIT));
+		p = std::clamp(p, 1e-7, 1 - 1e-7);
+
+		total -= sample.result * std::log(p) + (1 - sample.result) * std::log(1 - p);
+	}
+
+	return total / validation.size();
+}
+
+// round parameters to the integer scales of Nnue, saturating at the range of each type
+void NnueTrainer::quantize(Nnue* network) {
+	auto round = [](float value, double scale, double limit) {
+		return std::clamp(std::round(value * scale), -limit - 1, limit);
+	};
+
+	const float* w = params.data();
+
+	for (int j = 0; j < NNUE_L1; j ++)
+		network->l1Bias[j] = (int16_t) round(w[L1_BIAS + j], NNUE_QA, INT16_MAX);
+
+	for (int f = 0; f < NNUE_FEATURES; f ++)
+		for (int j = 0; j < NNUE_L1; j ++)
+			network->l1Weights[f][j] = (int16_t) round(w[L1_WEIGHTS + f * NNUE_L1 + j], NNUE_QA, INT16_MAX);
+
+	for (int i = 0; i < NNUE_L2; i ++) {
+		network->l2Bias[i] = (int32_t) round(w[L2_BIAS + i], NNUE_QA * NNUE_QB, INT32_MAX);
+
+		for (int j = 0; j < 2 * NNUE_L1; j ++)
+			network->l2Weights[i][j] = (int8_t) round(w[L2_WEIGHTS + i * 2 * NNUE_L1 + j], NNUE_QB, INT8_MAX);
+
+		network->outWeights[i] = (int16_t) round(w[OUT_WEIGHTS + i], NNUE_QO, INT16_MAX);
+	}
+
+	network->outBias = (int32_t) round(w[OUT_BIAS], NNUE_QA * NNUE_QO, INT32_MAX);
+}
+
+} // end namespace Bbot2
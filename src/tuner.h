@@ -0,0 +1,149 @@
+// tuner.h
+
+// texel-style tuning of Bbot's evaluation parameters
+// 1. positions are sampled from self-play games, and stored with the result of their game
+// 2. evaluate is linear in every EvalParam, so each position is reduced once to a feature vector:
+//    the white-relative evaluation with all parameters at 0, and the change when each parameter is set to 1
+// 3. parameters are fitted by minimizing the logistic loss between sigmoid(K * eval) and game results
+//    K is fitted to the current parameters first, so evaluation units stay the same
+// loss and gradients are summed over slices of the dataset on several threads
+
+// only quiet positions are sampled, where no piece is forced and neither side threatens to win
+// as the static evaluation is not meant to be trusted otherwise
+
+// NnueTrainer fits the network of nnue.h to the same datasets: a float copy of the network is trained by minibatch Adam
+// on the logistic loss of its output against game results, then quantized and saved
+
+#pragma once
+
+#include "common.h"
+#include "log.h"
+#include "board.h"
+#include "game.h"
+#include "bbot.h"
+#include "nnue.h"
+#include <atomic>
+#include <mutex>
+#include <random>
+
+namespace Bbot2 {
+
+// position sample, as stored in a dataset file
+// a dataset is a flat array of samples with no header, so new games can be appended
+typedef struct TuneSample {
+	PackedBoard position;
+	u_byte sideToMove;
+	u_byte result; // 0 = black win, 1 = draw, 2 = white win
+} TuneSample;
+
+static_assert(sizeof(TuneSample) == NUM_PIECES + 2, "TuneSample must be packed");
+
+
+class Tuner {
+	////
+
+	//// SETTINGS ////
+
+	// self-play
+	static const int GEN_RANDOM_PLIES = 8; // random moves played at the start of each game, so games differ
+	static const int GEN_MAX_PLIES = 200; // game is declared a draw after this many plies
+
+	// optimizer (Adam)
+	const double LEARNING_RATE = 10; // largest step of a parameter per iteration, in evaluation units
+	const double BETA_1 = 0.9;
+	const double BETA_2 = 0.999;
+
+	////
+
+	int numThreads;
+
+	// parameters
+	std::vector<EvalParam> paramList; // names of parameters. values are held in params
+	std::vector<double> params; // values, in evaluation units
+	int numParams = 0;
+
+	// dataset, reduced to features
+	std::vector<float> features; // [sample * numParams + param]
+	std::vector<float> base; // white-relative evaluation with all parameters at 0
+	std::vector<float> results; // 0 = black win, 0.5 = draw, 1 = white win
+	size_t numSamples = 0;
+
+	double K = 0; // scaling of evaluation to win probability
+	double initialLoss = 0;
+	double finalLoss = 0;
+
+public:
+	Tuner(CSimpleIniA* config, int numThreads_);
+
+	static void generate(std::string filename, CSimpleIniA* config, int numGames, int maxDepth, int numThreads);
+
+	void load(std::string filename);
+	void fit(int iterations);
+	void print();
+
+private:
+	double loss(std::vector<double>& w, double k, std::vector<double>* gradient);
+	void fit_K();
+
+	static void gen_worker(std::vector<TuneSample>* samples, std::mutex* lock, std::atomic<int>* gamesLeft, CSimpleIniA* config, int maxDepth, unsigned int seed);
+
+	static TuneSample sample_of(Board* board);
+};
+
+
+// position sample, reduced to the active network features of each side
+typedef struct NnueSample {
+	u_short features[NUM_SIDES][NNUE_MAX_ACTIVE];
+	u_byte numFeatures;
+	Side sideToMove;
+	float result; // for side to move: 0 = loss, 0.5 = draw, 1 = win
+} NnueSample;
+
+class NnueTrainer {
+	////
+
+	//// SETTINGS ////
+
+	// optimizer (Adam)
+	const float LEARNING_RATE = 0.001f;
+	const float BETA_1 = 0.9f;
+	const float BETA_2 = 0.999f;
+	static const int BATCH_SIZE = 4096;
+
+	static const int VALIDATION_SHARE = 20; // one in this many samples is held out of training, to measure loss on
+
+	////
+
+	// float parameters, in one array laid out as Nnue, in units of activations (1.0 = NNUE_QA)
+	static const int L1_BIAS = 0;
+	static const int L1_WEIGHTS = L1_BIAS + NNUE_L1;
+	static const int L2_BIAS = L1_WEIGHTS + NNUE_FEATURES * NNUE_L1;
+	static const int L2_WEIGHTS = L2_BIAS + NNUE_L2;
+	static const int OUT_BIAS = L2_WEIGHTS + NNUE_L2 * 2 * NNUE_L1;
+	static const int OUT_WEIGHTS = OUT_BIAS + 1;
+	static const int NUM_PARAMS = OUT_WEIGHTS + NNUE_L2;
+
+	int numThreads;
+	std::mt19937 rng;
+
+	std::vector<float> params;
+
+	std::vector<NnueSample> training;
+	std::vector<NnueSample> validation;
+
+public:
+	NnueTrainer(int numThreads_, unsigned int seed);
+
+	void load(std::string filename);
+	void train(int epochs);
+	void save(std::string filename);
+
+private:
+	double loss(const std::vector<NnueSample>& samples, const size_t* order, size_t count, std::vector<float>* gradient);
+	float forward(const NnueSample& sample, float* gradient);
+	double quantized_loss(const Nnue& network);
+
+	void quantize(Nnue* network);
+};
+
+} // end namespace Bbot2